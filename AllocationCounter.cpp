@@ -0,0 +1,33 @@
+#include <new>
+
+#include "AllocationCounter.h"
+
+#ifdef COUNT_ALLOCATIONS
+
+static thread_local long long allocations = 0;
+
+long long AllocationCounter::Count() {
+	return allocations;
+}
+
+// Array new, nothrow new and the sized deletes all end up here by default
+void * operator new(size_t size) {
+	++allocations;
+	void * p = malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void * p) noexcept {
+	free(p);
+}
+
+#else
+
+long long AllocationCounter::Count() {
+	return 0;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <iostream>
+#include <cstdlib>
+
+// Counts the heap allocations made on each thread, so that code which is meant never to allocate
+// (the search) can check that it doesn't. Counting means replacing the global operator new, so it is
+// only built in when COUNT_ALLOCATIONS is defined, as it is by make debug; otherwise nothing is counted
+class AllocationCounter {
+
+public:
+
+	// Allocations made so far by the calling thread
+	static long long Count();
+
+};
+
+// Aborts if the calling thread allocates anything between the check's construction and destruction;
+// compiles to nothing unless allocations are being counted
+class NoAllocationCheck {
+
+#ifdef COUNT_ALLOCATIONS
+
+	const char * where;
+	long long start;
+
+public:
+
+	explicit NoAllocationCheck(const char * w) : where(w), start(AllocationCounter::Count()) { }
+
+	~NoAllocationCheck() {
+		long long allocations = AllocationCounter::Count() - start;
+		if (allocations) {
+			std::cerr << where << " made " << allocations << " heap allocations" << std::endl;
+			abort();
+		}
+	}
+
+#else
+
+public:
+
+	explicit NoAllocationCheck(const char *) { }
+
+#endif
+
+};
+
+#endif
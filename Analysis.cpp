@@ -0,0 +1,221 @@
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "Analysis.h"
+#include "Bitboard.h"
+#include "Player.h"
+
+// Reads the numbers of the positions straight out of a large buffer, as parsing them through
+// an istream would take longer than searching shallow positions
+class PositionReader {
+
+public:
+
+	PositionReader(FILE * file) : file(file), size(0), position(0) { }
+
+	// Reads the next position; returns false at the end of the input. A position whose squares or player
+	// to move aren't valid ids is still read, but isn't valid
+	bool Read(GameState * state, bool * valid) {
+		int b[8][8];
+		*valid = true;
+		for (int i = 0; i < 8; ++i) {
+			for (int j = 0; j < 8; ++j) {
+				if (!readNumber(&b[i][j])) {
+					return false;
+				}
+				*valid = *valid && b[i][j] >= 0 && b[i][j] <= 2;
+			}
+		}
+		int currentPlayerId, time;
+		if (!readNumber(&currentPlayerId) || !readNumber(&time)) {
+			return false;
+		}
+		*valid = *valid && (currentPlayerId == 1 || currentPlayerId == 2);
+		*state = GameState(b, currentPlayerId == 2 ? 2 : 1, currentPlayerId == 2 ? 1 : 2);
+		return true;
+	}
+
+private:
+
+	FILE * file;
+	char buffer[1 << 16];
+	size_t size;
+	size_t position;
+
+	// Next character, or EOF
+	int next() {
+		if (position == size) {
+			size = fread(buffer, 1, sizeof(buffer), file);
+			position = 0;
+			if (!size) {
+				return EOF;
+			}
+		}
+		return (unsigned char) buffer[position++];
+	}
+
+	// Skips to the next number and reads it; anything that isn't a digit or a minus sign separates numbers
+	bool readNumber(int * number) {
+		int c = next();
+		while (c != EOF && c != '-' && (c < '0' || c > '9')) {
+			c = next();
+		}
+		if (c == EOF) {
+			return false;
+		}
+		bool negative = c == '-';
+		if (negative) {
+			c = next();
+		}
+		*number = 0;
+		while (c >= '0' && c <= '9') {
+			*number = *number * 10 + (c - '0');
+			c = next();
+		}
+		if (negative) {
+			*number = -*number;
+		}
+		return true;
+	}
+
+};
+
+namespace {
+
+struct Job {
+	long long index;
+	GameState state;
+	bool valid;
+};
+
+// Positions waiting for a worker, and finished lines waiting for the ones before them
+struct Pipeline {
+	std::mutex lock;
+	std::condition_variable jobAdded, lineWritten;
+	std::deque<Job> jobs;
+	bool done;
+	std::map<long long, std::string> finished;
+	long long nextToWrite;
+	std::ostream * output;
+	int depthLimit;
+	long long nodeLimit;
+};
+
+}
+
+static std::string analyze(ComputerPlayer & player, const Job & job) {
+	std::ostringstream line;
+	line << job.index << '\t';
+	if (!job.valid) {
+		line << "error";
+		return line.str();
+	}
+
+	GameState state = job.state;
+	bool passed = false;
+	if (!Bitboard::Moves(state.own, state.opp)) {
+		state = GameState::Pass(state);
+		if (!Bitboard::Moves(state.own, state.opp)) {
+			// Over, so the score is the final disc difference with the empty squares going to the winner
+			int own = Bitboard::Count(job.state.own), opp = Bitboard::Count(job.state.opp);
+			int empties = 64 - own - opp;
+			line << "none\t" << own - opp + (own > opp ? empties : (own < opp ? -empties : 0)) << "\t0";
+			return line.str();
+		}
+		passed = true;
+	}
+
+	Location move = player.MakeMove(state);
+	const SearchStats * stats = player.LastStats();
+	if (passed) {
+		line << "pass\t" << -stats->score;
+	} else {
+		line << move.Name() << '\t' << stats->score;
+	}
+	line << '\t' << stats->depth;
+	return line.str();
+}
+
+static void worker(Pipeline * pipeline) {
+	ComputerPlayer player(pipeline->depthLimit, pipeline->nodeLimit);
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> guard(pipeline->lock);
+			while (pipeline->jobs.empty() && !pipeline->done) {
+				pipeline->jobAdded.wait(guard);
+			}
+			if (pipeline->jobs.empty()) {
+				return;
+			}
+			job = pipeline->jobs.front();
+			pipeline->jobs.pop_front();
+		}
+
+		std::string line = analyze(player, job);
+
+		// Write out every line that is no longer waiting on an earlier position
+		std::lock_guard<std::mutex> guard(pipeline->lock);
+		pipeline->finished[job.index] = line;
+		bool wrote = false;
+		while (!pipeline->finished.empty() && pipeline->finished.begin()->first == pipeline->nextToWrite) {
+			*pipeline->output << pipeline->finished.begin()->second << '\n';
+			pipeline->finished.erase(pipeline->finished.begin());
+			++pipeline->nextToWrite;
+			wrote = true;
+		}
+		if (wrote) {
+			pipeline->lineWritten.notify_one();
+		}
+	}
+}
+
+long long Analysis::Run(FILE * input, std::ostream & output, int workers, int depthLimit, long long nodeLimit) {
+	// Parallelism comes from analyzing many positions at once, so each search stays on one thread and keeps quiet
+	ComputerPlayer::threads = 1;
+	ComputerPlayer::verbose = false;
+
+	Pipeline pipeline;
+	pipeline.done = false;
+	pipeline.nextToWrite = 1;
+	pipeline.output = &output;
+	pipeline.depthLimit = depthLimit;
+	pipeline.nodeLimit = nodeLimit;
+
+	std::vector<std::thread> pool;
+	for (int t = 0; t < workers; ++t) {
+		pool.push_back(std::thread(worker, &pipeline));
+	}
+
+	// Enough positions in flight to keep every worker busy while one of them is on a slow position
+	const long long window = 4 * (long long) workers;
+
+	PositionReader reader(input);
+	Job job;
+	job.index = 0;
+	while (reader.Read(&job.state, &job.valid)) {
+		++job.index;
+		std::unique_lock<std::mutex> guard(pipeline.lock);
+		while (job.index - pipeline.nextToWrite >= window) {
+			pipeline.lineWritten.wait(guard);
+		}
+		pipeline.jobs.push_back(job);
+		pipeline.jobAdded.notify_one();
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(pipeline.lock);
+		pipeline.done = true;
+	}
+	pipeline.jobAdded.notify_all();
+	for (unsigned int t = 0; t < pool.size(); ++t) {
+		pool[t].join();
+	}
+	output.flush();
+	return job.index;
+}
@@ -0,0 +1,30 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <cstdio>
+#include <ostream>
+
+// Batch analysis of a stream of positions, for when there are far too many to start a game for each.
+//
+// Positions are read one after another in the same format Game::FromFile reads: 8 rows of 8 squares
+// (0 for empty, or the id of the player on it), the id of the player to move, and a time limit, which
+// is ignored since every position gets the same budget. Any whitespace separates the numbers.
+// Each position is searched by one of a pool of workers, and one line is written per position,
+// in the order they were read:
+//   index <tab> move <tab> score <tab> depth
+// where the index counts from 1, the move is written like f5 ("pass" if the player to move has to pass,
+// "none" if the game is over) and the score and depth are as in SearchStats, from the point of view of
+// the player to move. A position that can't be read as a board gets "error" instead of a move.
+class Analysis {
+
+public:
+
+	// Analyzes every position in the input with each search limited to the depth or number of nodes
+	// (0 for no limit; with neither, each search gets Game::timeLimit seconds). Reading stops being
+	// ahead of writing by more than a few positions per worker, so memory use doesn't grow with the input.
+	// Returns the number of positions analyzed
+	static long long Run(FILE * input, std::ostream & output, int workers, int depthLimit, long long nodeLimit);
+
+};
+
+#endif
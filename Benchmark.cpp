@@ -0,0 +1,315 @@
+/*
+ * Microbenchmarks for the engine's hot paths, run over a fixed corpus of positions from played-out games.
+ * Every benchmark is repeated several times, and reports the median time per operation (with the spread),
+ * heap allocations per operation and, for the search, nodes per second.
+ *
+ * Usage: bench [--json file] [--repetitions count]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Game.h"
+#include "Bitboard.h"
+#include "Heuristic.h"
+
+using namespace std;
+
+// Every heap allocation in the process goes through here so that the benchmarks can count them
+static atomic<long long> allocations(0);
+
+void * operator new(size_t size) {
+	allocations.fetch_add(1, memory_order_relaxed);
+	void * p = malloc(size ? size : 1);
+	if (!p) {
+		throw bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void * p) noexcept {
+	free(p);
+}
+
+// Results are folded into this so that the compiler can't throw the work away
+static volatile long long sink;
+
+class Benchmark {
+
+public:
+
+	struct Result {
+		string name;
+		long long opsPerRepetition;
+		vector<double> nsPerOp; // One per repetition
+		double allocationsPerOp;
+		long long nodes; // Search nodes over all repetitions, or 0
+		double seconds;
+	};
+
+	// Positions from games where each side mostly plays the heuristic's favourite move, and sometimes a random one
+	static vector<GameState> Corpus(int games) {
+		srand(1);
+		vector<GameState> corpus;
+		for (int g = 0; g < games; ++g) {
+			GameState state = GameState::Start();
+			for (int ply = 0; ply < 60; ++ply) {
+				vector<Location> moves = Game::LegalMoves(state);
+				if (moves.empty()) {
+					state = GameState::Pass(state);
+					if (Game::LegalMoves(state).empty()) {
+						break;
+					}
+					continue;
+				}
+				Location choice = moves[rand() % moves.size()];
+				if (rand() % 5) {
+					double best = 0;
+					for (unsigned int i = 0; i < moves.size(); ++i) {
+						// Children are seen from the opponent's side, so the best move leaves them worst off
+						double value = -Game::heuristic(GameState::ApplyMove(state, Game::GetChangedPieces(state, moves[i])));
+						if (i == 0 || value > best) {
+							best = value;
+							choice = moves[i];
+						}
+					}
+				}
+				state = GameState::ApplyMove(state, Game::GetChangedPieces(state, choice));
+				if (ply >= 8 && ply < 56) {
+					corpus.push_back(state);
+				}
+			}
+		}
+		return corpus;
+	}
+
+	// One pass over the corpus for each function; each returns the number of operations it did
+
+	static long long Heuristic(const vector<GameState> & corpus) {
+		double total = 0;
+		for (unsigned int i = 0; i < corpus.size(); ++i) {
+			total += Game::heuristic(corpus[i]);
+		}
+		sink += (long long) total;
+		return corpus.size();
+	}
+
+	static long long HeuristicBatch(const vector<GameState> & corpus) {
+		double total = 0;
+		double scores[::Heuristic::BATCH];
+		for (unsigned int i = 0; i + ::Heuristic::BATCH <= corpus.size(); i += ::Heuristic::BATCH) {
+			::Heuristic::EvaluateBatch(&corpus[i], ::Heuristic::BATCH, scores);
+			for (int j = 0; j < ::Heuristic::BATCH; ++j) {
+				total += scores[j];
+			}
+		}
+		sink += (long long) total;
+		return corpus.size() / ::Heuristic::BATCH * ::Heuristic::BATCH;
+	}
+
+	static long long LegalMoves(const vector<GameState> & corpus) {
+		long long total = 0;
+		for (unsigned int i = 0; i < corpus.size(); ++i) {
+			total += Game::LegalMoves(corpus[i]).size();
+		}
+		sink += total;
+		return corpus.size();
+	}
+
+	static long long GetChangedPieces(const vector<GameState> & corpus) {
+		long long ops = 0;
+		uint64_t total = 0;
+		for (unsigned int i = 0; i < corpus.size(); ++i) {
+			const GameState & state = corpus[i];
+			for (uint64_t moves = Bitboard::Moves(state.own, state.opp); moves; moves &= moves - 1) {
+				int square = Bitboard::FirstSquare(moves);
+				total += Game::GetChangedPieces(state, Location::FromSquare(square));
+				++ops;
+			}
+		}
+		sink += total;
+		return ops;
+	}
+
+	static long long GenerateMoves(const vector<GameState> & corpus) {
+		long long total = 0;
+		for (unsigned int i = 0; i < corpus.size(); ++i) {
+			total += MoveList(corpus[i]).count;
+		}
+		sink += total;
+		return corpus.size();
+	}
+
+	static long long ApplyMove(const vector<GameState> & corpus) {
+		long long ops = 0;
+		uint64_t total = 0;
+		for (unsigned int i = 0; i < corpus.size(); ++i) {
+			const GameState & state = corpus[i];
+			for (uint64_t moves = Bitboard::Moves(state.own, state.opp); moves; moves &= moves - 1) {
+				int square = Bitboard::FirstSquare(moves);
+				uint64_t changed = (1ULL << square) | Bitboard::Flips(state.own, state.opp, square);
+				total += GameState::ApplyMove(state, changed).own;
+				++ops;
+			}
+		}
+		sink += total;
+		return ops;
+	}
+
+	// A fixed-depth search of every position, each one starting from an empty transposition table
+	static const int SEARCH_DEPTH = 4;
+	static long long searchNodes;
+
+	static long long Search(const vector<GameState> & corpus) {
+		double total = 0;
+		for (unsigned int i = 0; i < corpus.size(); ++i) {
+			Game::transpositionTable.Clear();
+			SearchContext context;
+			context.Start(chrono::steady_clock::now() + chrono::hours(1), NULL);
+			total += Game::MinimaxSearch(corpus[i], INT_MIN, INT_MAX, 0, SEARCH_DEPTH, &context).value;
+			searchNodes += context.nodes;
+		}
+		sink += (long long) total;
+		return corpus.size();
+	}
+
+	// Runs one benchmark: the number of corpus passes per repetition is doubled until a repetition
+	// takes at least MIN_SECONDS, then every repetition is timed separately
+	static Result Run(const string & name, long long (*body)(const vector<GameState> &), const vector<GameState> & corpus, int repetitions) {
+		static const double MIN_SECONDS = 0.05;
+
+		Result result;
+		result.name = name;
+		searchNodes = 0;
+
+		int passes = 1;
+		while (true) {
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for (int p = 0; p < passes; ++p) {
+				body(corpus);
+			}
+			if (chrono::duration<double>(chrono::steady_clock::now() - start).count() >= MIN_SECONDS) {
+				break;
+			}
+			passes *= 2;
+		}
+
+		searchNodes = 0;
+		long long allocationsBefore = allocations.load();
+		long long totalOps = 0;
+		result.seconds = 0;
+		for (int r = 0; r < repetitions; ++r) {
+			long long ops = 0;
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for (int p = 0; p < passes; ++p) {
+				ops += body(corpus);
+			}
+			double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			result.nsPerOp.push_back(seconds * 1e9 / ops);
+			result.seconds += seconds;
+			totalOps += ops;
+			result.opsPerRepetition = ops;
+		}
+		result.allocationsPerOp = (double) (allocations.load() - allocationsBefore) / totalOps;
+		result.nodes = searchNodes;
+		return result;
+	}
+
+};
+
+long long Benchmark::searchNodes = 0;
+
+static double median(vector<double> values) {
+	sort(values.begin(), values.end());
+	size_t n = values.size();
+	return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+static double standardDeviation(const vector<double> & values) {
+	double mean = 0;
+	for (unsigned int i = 0; i < values.size(); ++i) {
+		mean += values[i];
+	}
+	mean /= values.size();
+	double variance = 0;
+	for (unsigned int i = 0; i < values.size(); ++i) {
+		variance += (values[i] - mean) * (values[i] - mean);
+	}
+	return sqrt(variance / values.size());
+}
+
+int main(int argc, char * argv[]) {
+	string jsonFile;
+	int repetitions = 10;
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+			jsonFile = argv[++i];
+		} else if (!strcmp(argv[i], "--repetitions") && i + 1 < argc) {
+			repetitions = max(1, atoi(argv[++i]));
+		} else {
+			cout << "Usage: " << argv[0] << " [--json file] [--repetitions count]" << endl;
+			return 1;
+		}
+	}
+
+	// The table is cleared before every search, so keep it small enough that clearing it doesn't dominate the timings
+	Game::transpositionTable.Resize(1);
+
+	vector<GameState> corpus = Benchmark::Corpus(20);
+	cout << "Corpus of " << corpus.size() << " positions, " << repetitions << " repetitions each" << endl << endl;
+
+	vector<Benchmark::Result> results;
+	results.push_back(Benchmark::Run("Game::heuristic", Benchmark::Heuristic, corpus, repetitions));
+	results.push_back(Benchmark::Run(::Heuristic::UsingAvx2() ? "Heuristic::EvaluateBatch (AVX2)" : "Heuristic::EvaluateBatch", Benchmark::HeuristicBatch, corpus, repetitions));
+	results.push_back(Benchmark::Run("Game::LegalMoves", Benchmark::LegalMoves, corpus, repetitions));
+	results.push_back(Benchmark::Run("Game::GetChangedPieces", Benchmark::GetChangedPieces, corpus, repetitions));
+	results.push_back(Benchmark::Run("MoveList", Benchmark::GenerateMoves, corpus, repetitions));
+	results.push_back(Benchmark::Run("GameState::ApplyMove", Benchmark::ApplyMove, corpus, repetitions));
+	results.push_back(Benchmark::Run("Game::MinimaxSearch", Benchmark::Search, corpus, repetitions));
+
+	for (unsigned int i = 0; i < results.size(); ++i) {
+		const Benchmark::Result & r = results[i];
+		cout << r.name << ": " << median(r.nsPerOp) << " ns/op (+/- " << standardDeviation(r.nsPerOp) << "), "
+			<< r.allocationsPerOp << " allocs/op";
+		if (r.nodes) {
+			cout << ", " << (long long) (r.nodes / r.seconds) << " nodes/sec";
+		}
+		cout << endl;
+	}
+
+	if (!jsonFile.empty()) {
+		ofstream json(jsonFile.c_str());
+		if (!json.is_open()) {
+			cout << "Could not write " << jsonFile << endl;
+			return 1;
+		}
+		json << "{\n  \"corpus_positions\": " << corpus.size() << ",\n  \"repetitions\": " << repetitions
+			<< ",\n  \"search_depth\": " << Benchmark::SEARCH_DEPTH << ",\n  \"benchmarks\": [\n";
+		for (unsigned int i = 0; i < results.size(); ++i) {
+			const Benchmark::Result & r = results[i];
+			vector<double> sorted = r.nsPerOp;
+			sort(sorted.begin(), sorted.end());
+			json << "    {\"name\": \"" << r.name << "\", \"ops_per_repetition\": " << r.opsPerRepetition
+				<< ", \"ns_per_op\": {\"median\": " << median(r.nsPerOp) << ", \"min\": " << sorted.front()
+				<< ", \"max\": " << sorted.back() << ", \"stddev\": " << standardDeviation(r.nsPerOp) << "}"
+				<< ", \"allocs_per_op\": " << r.allocationsPerOp;
+			if (r.nodes) {
+				json << ", \"nodes_per_sec\": " << (long long) (r.nodes / r.seconds);
+			}
+			json << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		json << "  ]\n}\n";
+		cout << endl << "Wrote " << jsonFile << endl;
+	}
+	return 0;
+}
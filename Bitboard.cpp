@@ -0,0 +1,29 @@
+#include "Bitboard.h"
+
+uint64_t Bitboard::rays[DIRECTIONS][64];
+uint64_t Bitboard::adjacent[64];
+
+// Fill in the tables before main runs
+bool Bitboard::tablesInitialized = Bitboard::initTables();
+
+bool Bitboard::initTables() {
+	// How far each direction moves, indexed by Direction
+	static const int rowStep[DIRECTIONS] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+	static const int columnStep[DIRECTIONS] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+
+	for (int square = 0; square < 64; ++square) {
+		adjacent[square] = 0;
+		for (int d = RIGHT; d < DIRECTIONS; ++d) {
+			uint64_t ray = 0;
+			int row = square / 8 + rowStep[d], column = square % 8 + columnStep[d];
+			while (row >= 0 && row < 8 && column >= 0 && column < 8) {
+				ray |= SquareBit(row, column);
+				row += rowStep[d];
+				column += columnStep[d];
+			}
+			rays[d][square] = ray;
+			adjacent[square] |= ray & Neighbors(1ULL << square);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,178 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+// Squares are numbered row * 8 + column, so bit 0 is (0, 0) and bit 63 is (7, 7).
+// Everything here is inline since it sits at the very bottom of the search
+class Bitboard {
+
+public:
+
+	// Clockwise from right. The first four step to higher square indices and the last four to lower ones
+	enum Direction { RIGHT, DOWN_RIGHT, DOWN, DOWN_LEFT, LEFT, UP_LEFT, UP, UP_RIGHT, DIRECTIONS };
+
+private:
+
+	// Masks that stop a shift from wrapping around to the other side of the board
+	static const uint64_t NOT_COLUMN_0 = 0xfefefefefefefefeULL;
+	static const uint64_t NOT_COLUMN_7 = 0x7f7f7f7f7f7f7f7fULL;
+
+	// Shifts left for positive amounts and right for negative amounts
+	static inline uint64_t shift(uint64_t b, int s) {
+		return s > 0 ? b << s : b >> -s;
+	}
+
+	// Kogge-Stone occluded fill: grows gen in direction s through the propagator squares
+	// in three doubling steps instead of walking the ray one square at a time
+	static inline uint64_t fill(uint64_t gen, uint64_t pro, int s) {
+		gen |= pro & shift(gen, s);
+		pro &= shift(pro, s);
+		gen |= pro & shift(gen, 2 * s);
+		pro &= shift(pro, 2 * s);
+		gen |= pro & shift(gen, 4 * s);
+		return gen;
+	}
+
+	// Moves that capture along a single direction
+	static inline uint64_t movesInDirection(uint64_t own, uint64_t opp, uint64_t empty, int s, uint64_t mask) {
+		uint64_t pro = opp & mask;
+		uint64_t chain = fill(own, pro, s) & ~own;
+		return shift(chain, s) & mask & empty;
+	}
+
+	// Squares along each of the 8 directions from each square (not including the square itself),
+	// and the squares adjacent to each square; filled in by Bitboard.cpp before main runs
+	static uint64_t rays[DIRECTIONS][64];
+	static uint64_t adjacent[64];
+	static bool tablesInitialized;
+
+	static bool initTables();
+
+	// Flips along a ray whose squares have increasing indices: the first square on the ray that isn't
+	// the opponent's is the lowest set bit, and everything on the ray below it gets flipped if it is ours
+	static inline uint64_t flipsUp(uint64_t own, uint64_t opp, uint64_t ray) {
+		uint64_t outflank = ray & ~opp;
+		outflank &= 0 - outflank;
+		return (outflank & own) ? ray & (outflank - 1) : 0;
+	}
+
+	// The same for rays with decreasing indices, where the first square that isn't the opponent's is the highest set bit
+	static inline uint64_t flipsDown(uint64_t own, uint64_t opp, uint64_t ray) {
+		uint64_t outflank = ray & ~opp;
+		if (!outflank) {
+			return 0;
+		}
+		outflank = 1ULL << (63 - __builtin_clzll(outflank));
+		return (outflank & own) ? ray & ~((outflank << 1) - 1) : 0;
+	}
+
+public:
+
+	static const uint64_t CORNERS = 0x8100000000000081ULL;
+
+	// Returns all squares where the player owning own can legally move
+	static inline uint64_t Moves(uint64_t own, uint64_t opp) {
+		uint64_t empty = ~(own | opp);
+		return movesInDirection(own, opp, empty, 1, NOT_COLUMN_0)
+			| movesInDirection(own, opp, empty, -1, NOT_COLUMN_7)
+			| movesInDirection(own, opp, empty, 8, ~0ULL)
+			| movesInDirection(own, opp, empty, -8, ~0ULL)
+			| movesInDirection(own, opp, empty, 9, NOT_COLUMN_0)
+			| movesInDirection(own, opp, empty, 7, NOT_COLUMN_7)
+			| movesInDirection(own, opp, empty, -7, NOT_COLUMN_0)
+			| movesInDirection(own, opp, empty, -9, NOT_COLUMN_7);
+	}
+
+	// Returns the opponent discs that flip when the player owning own moves on square.
+	// Flips only ever need one square's rays, so this scans them directly (a fill would do all 64 squares' work)
+	static inline uint64_t Flips(uint64_t own, uint64_t opp, int square) {
+		if (!(opp & adjacent[square])) {
+			return 0;
+		}
+		return flipsUp(own, opp, rays[RIGHT][square])
+			| flipsUp(own, opp, rays[DOWN_RIGHT][square])
+			| flipsUp(own, opp, rays[DOWN][square])
+			| flipsUp(own, opp, rays[DOWN_LEFT][square])
+			| flipsDown(own, opp, rays[LEFT][square])
+			| flipsDown(own, opp, rays[UP_LEFT][square])
+			| flipsDown(own, opp, rays[UP][square])
+			| flipsDown(own, opp, rays[UP_RIGHT][square]);
+	}
+
+	// Returns every square adjacent (in any of the 8 directions) to a square in b
+	static inline uint64_t Neighbors(uint64_t b) {
+		uint64_t horizontal = ((b << 1) & NOT_COLUMN_0) | ((b >> 1) & NOT_COLUMN_7);
+		uint64_t row = b | horizontal;
+		return horizontal | (row << 8) | (row >> 8);
+	}
+
+	static inline int Count(uint64_t b) {
+#ifdef __POPCNT__
+		return __builtin_popcountll(b);
+#else
+		// Without the popcnt instruction the builtin is a library call, which is slower than this
+		b = b - ((b >> 1) & 0x5555555555555555ULL);
+		b = (b & 0x3333333333333333ULL) + ((b >> 2) & 0x3333333333333333ULL);
+		b = (b + (b >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+		return (int) ((b * 0x0101010101010101ULL) >> 56);
+#endif
+	}
+
+	// Index of the lowest set bit; b must not be empty
+	static inline int FirstSquare(uint64_t b) {
+		return __builtin_ctzll(b);
+	}
+
+	static inline uint64_t SquareBit(int row, int column) {
+		return 1ULL << (row * 8 + column);
+	}
+
+	// The 8 symmetries of the board: bit 0 of s mirrors the columns, bit 1 mirrors the rows,
+	// and bit 2 then swaps rows with columns
+	static inline uint64_t Transform(uint64_t b, int s) {
+		if (s & 1) {
+			b = ((b >> 1) & 0x5555555555555555ULL) | ((b & 0x5555555555555555ULL) << 1);
+			b = ((b >> 2) & 0x3333333333333333ULL) | ((b & 0x3333333333333333ULL) << 2);
+			b = ((b >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((b & 0x0f0f0f0f0f0f0f0fULL) << 4);
+		}
+		if (s & 2) {
+			b = __builtin_bswap64(b);
+		}
+		if (s & 4) {
+			uint64_t t = 0x0f0f0f0f00000000ULL & (b ^ (b << 28));
+			b ^= t ^ (t >> 28);
+			t = 0x3333000033330000ULL & (b ^ (b << 14));
+			b ^= t ^ (t >> 14);
+			t = 0x5500550055005500ULL & (b ^ (b << 7));
+			b ^= t ^ (t >> 7);
+		}
+		return b;
+	}
+
+	// Where a square ends up under the same symmetry
+	static inline int TransformSquare(int square, int s) {
+		int row = square / 8, column = square % 8;
+		if (s & 1) {
+			column = 7 - column;
+		}
+		if (s & 2) {
+			row = 7 - row;
+		}
+		if (s & 4) {
+			int temp = row;
+			row = column;
+			column = temp;
+		}
+		return row * 8 + column;
+	}
+
+	// The symmetry that undoes s. Swapping rows with columns comes last in s, so undoing it comes first,
+	// and the mirrors that follow it trade places
+	static inline int InverseSymmetry(int s) {
+		return s & 4 ? 4 | ((s & 1) << 1) | ((s >> 1) & 1) : s;
+	}
+
+};
+
+#endif
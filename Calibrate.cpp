@@ -0,0 +1,271 @@
+/*
+ * Fits the Multi-ProbCut parameters (see ProbCut.h): searches a set of positions to every depth
+ * up to a limit, and for each phase of the game and each pair of depths a check would use,
+ * regresses the deep search's score on the shallow one's.
+ *
+ * Positions are taken from a game archive (every position a search would be asked about,
+ * before the endgame solver takes over), or from random games. The evaluation has to be the one
+ * that will be played with, so give the same --weights as the engine will use.
+ *
+ * Usage: calibrate [--games archive | --random count] [--positions count] [--max-depth plies]
+ *                  [--threads count] [--hash megabytes] [--exact empties] [--weights file] [--output file]
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Game.h"
+#include "Bitboard.h"
+#include "Endgame.h"
+#include "Pattern.h"
+#include "ProbCut.h"
+#include "GameArchive.h"
+
+using namespace std;
+
+// Sums for a least squares fit of deep = a * shallow + b
+struct Regression {
+	double n, x, y, xx, xy, yy;
+
+	Regression() : n(0), x(0), y(0), xx(0), xy(0), yy(0) { }
+
+	void Add(double shallow, double deep) {
+		n += 1;
+		x += shallow;
+		y += deep;
+		xx += shallow * shallow;
+		xy += shallow * deep;
+		yy += deep * deep;
+	}
+
+	// Returns false if there isn't enough to fit a line to
+	bool Fit(double * a, double * b, double * sigma) const {
+		double varianceX = xx / n - (x / n) * (x / n);
+		if (n < MIN_SAMPLES || varianceX <= 0) {
+			return false;
+		}
+		*a = (xy / n - (x / n) * (y / n)) / varianceX;
+		*b = y / n - *a * x / n;
+
+		// Residual variance, from the sums: mean of (y - a x - b)^2
+		double residual = yy / n - 2 * *a * xy / n - 2 * *b * y / n + *a * *a * xx / n + 2 * *a * *b * x / n + *b * *b;
+		*sigma = sqrt(max(0.0, residual));
+		return true;
+	}
+
+	static const int MIN_SAMPLES = 30;
+};
+
+// The shallow searches checked for a deep one: about a third of its depth, with the same parity since the
+// heuristic leans towards whoever is to move at the leaves, and a second one two plies deeper when there's room
+static int shallowDepths(int depth, int * shallow) {
+	int first = max(1, depth / 3);
+	if ((depth - first) % 2) {
+		++first;
+	}
+	int count = 0;
+	shallow[count++] = first;
+	if (first + 2 <= depth - 2 && count < ProbCut::MAX_CHECKS) {
+		shallow[count++] = first + 2;
+	}
+	return count;
+}
+
+struct Samples {
+	mutex lock;
+	Regression fits[ProbCut::PHASES][ProbCut::MAX_DEPTH + 1][ProbCut::MAX_CHECKS];
+	int done;
+};
+
+static void worker(const vector<GameState> * positions, int maxDepth, atomic<int> * next, Samples * samples) {
+	SearchContext context;
+	double scores[ProbCut::MAX_DEPTH + 1];
+	while (true) {
+		int index = next->fetch_add(1);
+		if (index >= (int) positions->size()) {
+			return;
+		}
+		GameState state = (*positions)[index];
+		int empties = 64 - Bitboard::Count(state.own | state.opp);
+		int depths = min(maxDepth, empties);
+
+		// Full window searches, so that every score is exact
+		context.Start(chrono::steady_clock::time_point::max(), NULL);
+		context.probCut = false;
+		context.orderer.NewSearch();
+		for (int depth = 1; depth <= depths; ++depth) {
+			context.depthTracker = 0;
+			scores[depth] = Game::MinimaxSearch(state, INT_MIN, INT_MAX, 0, depth, &context).value;
+		}
+
+		lock_guard<mutex> guard(samples->lock);
+		int phase = ProbCut::Phase(empties);
+		for (int depth = ProbCut::MIN_DEPTH; depth <= depths; ++depth) {
+			int shallow[ProbCut::MAX_CHECKS];
+			int count = shallowDepths(depth, shallow);
+			for (int c = 0; c < count; ++c) {
+				samples->fits[phase][depth][c].Add(scores[shallow[c]], scores[depth]);
+			}
+		}
+		if (++samples->done % 100 == 0 || samples->done == (int) positions->size()) {
+			cout << samples->done << "/" << positions->size() << " positions searched" << endl;
+		}
+	}
+}
+
+// Every position of every game that a search would be asked about
+static bool archivePositions(const string & fileName, int limit, vector<GameState> * positions) {
+	GameArchiveReader archive;
+	if (!archive.Open(fileName)) {
+		return false;
+	}
+	GameArchiveReader::Entry game;
+	while ((int) positions->size() < limit && archive.Next(&game)) {
+		GameState state = game.Start();
+		for (int i = 0; i < game.header->moveCount && (int) positions->size() < limit; ++i) {
+			if (!Bitboard::Moves(state.own, state.opp)) {
+				state = GameState::Pass(state);
+			}
+			if (64 - Bitboard::Count(state.own | state.opp) > Endgame::exactEmpties) {
+				positions->push_back(state);
+			}
+			int square = game.moves[i];
+			state = GameState::ApplyMove(state, (1ULL << square) | Bitboard::Flips(state.own, state.opp, square));
+		}
+	}
+	return true;
+}
+
+// Positions from random games, spread evenly over the plies before the endgame solver takes over
+static vector<GameState> randomPositions(int count) {
+	srand(1);
+	vector<GameState> positions;
+	while ((int) positions.size() < count) {
+		GameState state = GameState::Start();
+		int plies = rand() % max(1, 60 - Endgame::exactEmpties);
+		for (int ply = 0; ply < plies; ++ply) {
+			uint64_t moves = Bitboard::Moves(state.own, state.opp);
+			if (!moves) {
+				state = GameState::Pass(state);
+				moves = Bitboard::Moves(state.own, state.opp);
+				if (!moves) {
+					break;
+				}
+			}
+			for (int skip = rand() % Bitboard::Count(moves); skip; --skip) {
+				moves &= moves - 1;
+			}
+			int square = Bitboard::FirstSquare(moves);
+			state = GameState::ApplyMove(state, (1ULL << square) | Bitboard::Flips(state.own, state.opp, square));
+		}
+		if (Bitboard::Moves(state.own, state.opp)) {
+			positions.push_back(state);
+		}
+	}
+	return positions;
+}
+
+int main(int argc, char * argv[]) {
+	string gamesFile;
+	string outputFile = "probcut.txt";
+	int randomCount = 0;
+	int limit = 2000;
+	int maxDepth = 10;
+	int threads = max(1u, thread::hardware_concurrency());
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--games") && i + 1 < argc) {
+			gamesFile = argv[++i];
+		} else if (!strcmp(argv[i], "--random") && i + 1 < argc) {
+			randomCount = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--positions") && i + 1 < argc) {
+			limit = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--max-depth") && i + 1 < argc) {
+			maxDepth = max(ProbCut::MIN_DEPTH, min(ProbCut::MAX_DEPTH, atoi(argv[++i])));
+		} else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			threads = max(1, atoi(argv[++i]));
+		} else if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+			Game::transpositionTable.Resize(atoi(argv[++i]));
+		} else if (!strcmp(argv[i], "--exact") && i + 1 < argc) {
+			Endgame::exactEmpties = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--weights") && i + 1 < argc) {
+			if (!Pattern::Load(argv[++i])) {
+				cout << "Could not load pattern weights from " << argv[i] << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+			outputFile = argv[++i];
+		} else {
+			cout << "Usage: " << argv[0] << " [--games archive | --random count] [--positions count] [--max-depth plies]"
+				<< " [--threads count] [--hash megabytes] [--exact empties] [--weights file] [--output file]" << endl;
+			return 1;
+		}
+	}
+
+	vector<GameState> positions;
+	if (!gamesFile.empty()) {
+		if (!archivePositions(gamesFile, limit, &positions)) {
+			cout << "Could not open game archive " << gamesFile << endl;
+			return 1;
+		}
+	} else {
+		positions = randomPositions(randomCount ? randomCount : limit);
+	}
+	if (positions.empty()) {
+		cout << "No positions to search" << endl;
+		return 1;
+	}
+
+	// Later positions from the same game are searched next to each other otherwise, which would leave some
+	// threads with all the slow midgame positions
+	srand(2);
+	random_shuffle(positions.begin(), positions.end());
+
+	cout << "Searching " << positions.size() << " positions to depth " << maxDepth << " on " << threads << " threads" << endl;
+
+	Samples samples;
+	samples.done = 0;
+	atomic<int> next(0);
+	vector<thread> pool;
+	for (int t = 0; t < threads; ++t) {
+		pool.push_back(thread(worker, &positions, maxDepth, &next, &samples));
+	}
+	for (unsigned int t = 0; t < pool.size(); ++t) {
+		pool[t].join();
+	}
+
+	ProbCut::Clear();
+	cout << endl << "phase depth shallow samples a b sigma" << endl;
+	for (int phase = 0; phase < ProbCut::PHASES; ++phase) {
+		for (int depth = ProbCut::MIN_DEPTH; depth <= maxDepth; ++depth) {
+			int shallow[ProbCut::MAX_CHECKS];
+			int count = shallowDepths(depth, shallow);
+			for (int c = 0; c < count; ++c) {
+				const Regression & fit = samples.fits[phase][depth][c];
+				ProbCut::Check check;
+				check.depth = shallow[c];
+				if (!fit.Fit(&check.a, &check.b, &check.sigma) || check.a <= 0) {
+					continue;
+				}
+				ProbCut::Add(phase, depth, check);
+				cout << phase << " " << depth << " " << check.depth << " " << (int) fit.n << " "
+					<< check.a << " " << check.b << " " << check.sigma << endl;
+			}
+		}
+	}
+
+	if (!ProbCut::Save(outputFile)) {
+		cout << "Could not write " << outputFile << endl;
+		return 1;
+	}
+	cout << "Wrote " << outputFile << endl;
+	return 0;
+}
@@ -0,0 +1,385 @@
+#include "Endgame.h"
+#include "Bitboard.h"
+#include "Game.h"
+#include "AllocationCounter.h"
+
+int Endgame::exactEmpties = 20;
+int Endgame::wldEmpties = 22;
+
+const uint64_t Endgame::quadrantMask[4] = {
+	0x000000000f0f0f0fULL, 0x00000000f0f0f0f0ULL, 0x0f0f0f0f00000000ULL, 0xf0f0f0f000000000ULL
+};
+
+bool Endgame::SolveRoot(GameState state, bool wld, SearchContext * context, int * bestSquare, int * score, long long * nodes) {
+	NoAllocationCheck allocationCheck("Endgame::SolveRoot");
+	Search search = { context, 0, false, context ? context->nodeLimit : 0, 0 };
+	int empties = 64 - Bitboard::Count(state.own | state.opp);
+
+	// A win/loss/draw search is just an exact search with a null window around a draw
+	int alpha = wld ? -1 : -65;
+	int beta = wld ? 1 : 65;
+
+	// A position solved in an earlier run needs no search, if the cache has a move for it and its score settles the window
+	PositionCache::Entry cached;
+	if (Game::positionCache.Probe(state, PositionCache::ENDGAME, &cached) && cached.move != TranspositionTable::NO_MOVE) {
+		int value = (int) cached.score;
+		if (cached.bound == TranspositionTable::EXACT
+			|| (cached.bound == TranspositionTable::LOWER && value >= beta)
+			|| (cached.bound == TranspositionTable::UPPER && value <= alpha)) {
+			*bestSquare = cached.move;
+			*score = wld ? (value > 0 ? 1 : (value < 0 ? -1 : 0)) : value;
+			*nodes = 0;
+			return true;
+		}
+	}
+	int windowAlpha = alpha;
+
+	uint64_t moves = Bitboard::Moves(state.own, state.opp);
+	int squares[64];
+	int count = orderMoves(state.own, state.opp, moves, empties, TranspositionTable::NO_MOVE, squares);
+
+	*bestSquare = count ? squares[0] : TranspositionTable::NO_MOVE;
+	*score = -65;
+	bool finished = true;
+	for (int i = 0; i < count; ++i) {
+		uint64_t flips = Bitboard::Flips(state.own, state.opp, squares[i]);
+		int value = -solveDeep(state.opp & ~flips, state.own | flips | (1ULL << squares[i]), -beta, -alpha, empties - 1, false, &search);
+		if (search.aborted) {
+			finished = false;
+			break;
+		}
+		if (value > *score) {
+			*score = value;
+			*bestSquare = squares[i];
+		}
+		if (value > alpha) {
+			alpha = value;
+		}
+		if (alpha >= beta) {
+			break;
+		}
+	}
+
+	if (finished && *bestSquare != TranspositionTable::NO_MOVE) {
+		TranspositionTable::Bound bound = *score >= beta ? TranspositionTable::LOWER : (*score > windowAlpha ? TranspositionTable::EXACT : TranspositionTable::UPPER);
+		Game::positionCache.Store(state, PositionCache::ENDGAME, empties, bound, *score, *bestSquare);
+	}
+
+	if (wld) {
+		*score = *score > 0 ? 1 : (*score < 0 ? -1 : 0);
+	}
+	*nodes = search.nodes;
+	return finished;
+}
+
+int Endgame::Solve(GameState state, int alpha, int beta, SearchContext * context, long long * nodes) {
+	NoAllocationCheck allocationCheck("Endgame::Solve");
+	Search search = { context, 0, false, context ? context->nodeLimit : 0, 0 };
+	int value = solveDeep(state.own, state.opp, alpha, beta, 64 - Bitboard::Count(state.own | state.opp), false, &search);
+	*nodes = search.nodes;
+	return value;
+}
+
+int Endgame::finalScore(uint64_t own, uint64_t opp) {
+	int ownCount = Bitboard::Count(own);
+	int oppCount = Bitboard::Count(opp);
+	int empties = 64 - ownCount - oppCount;
+	if (ownCount > oppCount) {
+		return ownCount - oppCount + empties;
+	} else if (ownCount < oppCount) {
+		return ownCount - oppCount - empties;
+	}
+	return 0;
+}
+
+int Endgame::orderMoves(uint64_t own, uint64_t opp, uint64_t moves, int empties, int hashMove, int * squares) {
+	// Quadrants with an odd number of empties; moving there tends to leave us the last move in the region
+	uint64_t emptyMask = ~(own | opp);
+	int parity = 0;
+	for (int q = 0; q < 4; ++q) {
+		if (Bitboard::Count(emptyMask & quadrantMask[q]) & 1) {
+			parity |= 1 << q;
+		}
+	}
+
+	int scores[64];
+	int count = 0;
+	for (; moves; moves &= moves - 1) {
+		int square = Bitboard::FirstSquare(moves);
+		int value = (parity & (1 << quadrant(square))) ? 1 : 0;
+		if (square == hashMove) {
+			value = 1 << 20;
+		} else if (empties > FASTEST_FIRST_EMPTIES) {
+			// Fastest first: leave the opponent as few replies as possible, and take corners
+			uint64_t flips = Bitboard::Flips(own, opp, square);
+			uint64_t newOwn = own | flips | (1ULL << square);
+			uint64_t newOpp = opp & ~flips;
+			uint64_t replies = Bitboard::Moves(newOpp, newOwn);
+			int mobility = Bitboard::Count(replies);
+			int corners = Bitboard::Count(replies & Bitboard::CORNERS);
+			value += 8 * (((1ULL << square) & Bitboard::CORNERS) ? 1 : 0) - 16 * mobility - 8 * corners;
+		}
+
+		// Insertion sort as we go
+		int j = count++;
+		while (j > 0 && scores[j - 1] < value) {
+			scores[j] = scores[j - 1];
+			squares[j] = squares[j - 1];
+			--j;
+		}
+		scores[j] = value;
+		squares[j] = square;
+	}
+	return count;
+}
+
+int Endgame::solveDeep(uint64_t own, uint64_t opp, int alpha, int beta, int empties, bool passed, Search * search) {
+	// Hand off to the specialized kernels for the last few empties
+	if (empties <= 4) {
+		int x[4] = { 0, 0, 0, 0 };
+		uint64_t emptyMask = ~(own | opp);
+		for (int i = 0; i < empties; ++i) {
+			x[i] = Bitboard::FirstSquare(emptyMask);
+			emptyMask &= emptyMask - 1;
+		}
+		switch (empties) {
+			case 4: return solve4(own, opp, alpha, beta, x[0], x[1], x[2], x[3], search);
+			case 3: return solve3(own, opp, alpha, beta, x[0], x[1], x[2], search);
+			case 2: return solve2(own, opp, alpha, beta, x[0], x[1], search);
+			case 1: ++search->nodes; return solve1(own, opp, x[0]);
+			default: ++search->nodes; return finalScore(own, opp);
+		}
+	}
+
+	if (countNode(search)) {
+		return alpha;
+	}
+
+	uint64_t moves = Bitboard::Moves(own, opp);
+	if (!moves) {
+		if (passed) {
+			return finalScore(own, opp);
+		}
+		return -solveDeep(opp, own, -beta, -alpha, empties, true, search);
+	}
+
+	// Every entry for a position is a search to the end of the game, so the stored depth never matters
+	uint64_t key = 0;
+	int hashMove = TranspositionTable::NO_MOVE;
+	if (empties >= TABLE_EMPTIES) {
+		key = TranspositionTable::Hash(GameState(own, opp)) ^ TABLE_KEY;
+		TranspositionTable::Entry entry;
+		bool found = Game::transpositionTable.Probe(key, &entry);
+
+		// Far enough from the end, the persistent cache may have the position from an earlier run;
+		// it goes into the table so that transpositions find it there
+		if (!found && empties >= PositionCache::MIN_EMPTIES && Game::positionCache.IsOpen()) {
+			PositionCache::Entry cached;
+			if (Game::positionCache.Probe(GameState(own, opp), PositionCache::ENDGAME, &cached)) {
+				Game::transpositionTable.Store(key, empties, cached.bound, cached.score, cached.move);
+				found = true;
+				entry.score = cached.score;
+				entry.bound = cached.bound;
+				entry.move = cached.move;
+			}
+		}
+		if (found) {
+			int value = (int) entry.score;
+			if (entry.bound == TranspositionTable::EXACT
+				|| (entry.bound == TranspositionTable::LOWER && value >= beta)
+				|| (entry.bound == TranspositionTable::UPPER && value <= alpha)) {
+				return value;
+			}
+			hashMove = entry.move;
+		}
+	}
+
+	int squares[64];
+	int count = orderMoves(own, opp, moves, empties, hashMove, squares);
+
+	int best = -65;
+	int bestSquare = TranspositionTable::NO_MOVE;
+	int lower = alpha;
+	for (int i = 0; i < count; ++i) {
+		uint64_t flips = Bitboard::Flips(own, opp, squares[i]);
+		uint64_t newOwn = opp & ~flips, newOpp = own | flips | (1ULL << squares[i]);
+
+		// Principal variation search: the first move gets the full window and the rest are only
+		// checked for whether they beat it, with a full search if one does
+		int value;
+		if (i == 0) {
+			value = -solveDeep(newOwn, newOpp, -beta, -lower, empties - 1, false, search);
+		} else {
+			value = -solveDeep(newOwn, newOpp, -lower - 1, -lower, empties - 1, false, search);
+			if (value > lower && value < beta) {
+				value = -solveDeep(newOwn, newOpp, -beta, -value, empties - 1, false, search);
+			}
+		}
+		if (search->aborted) {
+			return alpha;
+		}
+		if (value > best) {
+			best = value;
+			bestSquare = squares[i];
+			if (best > lower) {
+				lower = best;
+			}
+			if (best >= beta) {
+				break;
+			}
+		}
+	}
+
+	if (key) {
+		TranspositionTable::Bound bound = best >= beta ? TranspositionTable::LOWER : (best > alpha ? TranspositionTable::EXACT : TranspositionTable::UPPER);
+		Game::transpositionTable.Store(key, empties, bound, best, bestSquare);
+		if (empties >= PositionCache::MIN_EMPTIES) {
+			Game::positionCache.Store(GameState(own, opp), PositionCache::ENDGAME, empties, bound, best, bestSquare);
+		}
+	}
+	return best;
+}
+
+int Endgame::solve4(uint64_t own, uint64_t opp, int alpha, int beta, int x1, int x2, int x3, int x4, Search * search) {
+	if (countNode(search)) {
+		return alpha;
+	}
+
+	// Parity ordering: squares alone in their quadrant (or with two others) go first
+	uint64_t emptyMask = (1ULL << x1) | (1ULL << x2) | (1ULL << x3) | (1ULL << x4);
+	int x[4] = { x1, x2, x3, x4 };
+	int n = 0;
+	int sorted[4];
+	for (int pass = 0; pass < 2; ++pass) {
+		for (int i = 0; i < 4; ++i) {
+			bool odd = Bitboard::Count(emptyMask & quadrantMask[quadrant(x[i])]) & 1;
+			if (odd == (pass == 0)) {
+				sorted[n++] = x[i];
+			}
+		}
+	}
+
+	int best = -65;
+	for (int i = 0; i < 4; ++i) {
+		uint64_t flips = Bitboard::Flips(own, opp, sorted[i]);
+		if (!flips) {
+			continue;
+		}
+		// The other three squares, still in sorted order
+		int rest[3];
+		for (int j = 0, r = 0; j < 4; ++j) {
+			if (j != i) {
+				rest[r++] = sorted[j];
+			}
+		}
+		int value = -solve3(opp & ~flips, own | flips | (1ULL << sorted[i]), -beta, -(best > alpha ? best : alpha), rest[0], rest[1], rest[2], search);
+		if (value > best) {
+			best = value;
+			if (best >= beta) {
+				return best;
+			}
+		}
+	}
+
+	if (best == -65) {
+		// No moves: pass if the opponent can move, otherwise the game is over
+		if (Bitboard::Moves(opp, own) & emptyMask) {
+			return -solve4(opp, own, -beta, -alpha, sorted[0], sorted[1], sorted[2], sorted[3], search);
+		}
+		return finalScore(own, opp);
+	}
+	return best;
+}
+
+int Endgame::solve3(uint64_t own, uint64_t opp, int alpha, int beta, int x1, int x2, int x3, Search * search) {
+	if (countNode(search)) {
+		return alpha;
+	}
+
+	int best = -65;
+	uint64_t flips;
+	if ((flips = Bitboard::Flips(own, opp, x1))) {
+		best = -solve2(opp & ~flips, own | flips | (1ULL << x1), -beta, -alpha, x2, x3, search);
+		if (best >= beta) {
+			return best;
+		}
+	}
+	if ((flips = Bitboard::Flips(own, opp, x2))) {
+		int value = -solve2(opp & ~flips, own | flips | (1ULL << x2), -beta, -(best > alpha ? best : alpha), x1, x3, search);
+		if (value > best) {
+			best = value;
+			if (best >= beta) {
+				return best;
+			}
+		}
+	}
+	if ((flips = Bitboard::Flips(own, opp, x3))) {
+		int value = -solve2(opp & ~flips, own | flips | (1ULL << x3), -beta, -(best > alpha ? best : alpha), x1, x2, search);
+		if (value > best) {
+			best = value;
+		}
+	}
+
+	if (best == -65) {
+		uint64_t emptyMask = (1ULL << x1) | (1ULL << x2) | (1ULL << x3);
+		if (Bitboard::Moves(opp, own) & emptyMask) {
+			return -solve3(opp, own, -beta, -alpha, x1, x2, x3, search);
+		}
+		return finalScore(own, opp);
+	}
+	return best;
+}
+
+int Endgame::solve2(uint64_t own, uint64_t opp, int alpha, int beta, int x1, int x2, Search * search) {
+	++search->nodes;
+
+	int best = -65;
+	uint64_t flips;
+	if ((flips = Bitboard::Flips(own, opp, x1))) {
+		best = -solve1(opp & ~flips, own | flips | (1ULL << x1), x2);
+		if (best >= beta) {
+			return best;
+		}
+	}
+	if ((flips = Bitboard::Flips(own, opp, x2))) {
+		int value = -solve1(opp & ~flips, own | flips | (1ULL << x2), x1);
+		if (value > best) {
+			best = value;
+		}
+	}
+
+	if (best == -65) {
+		// Try the opponent's moves directly instead of passing back through solve2
+		if ((flips = Bitboard::Flips(opp, own, x1))) {
+			best = solve1(own & ~flips, opp | flips | (1ULL << x1), x2);
+			if (best <= alpha) {
+				return best;
+			}
+		}
+		if ((flips = Bitboard::Flips(opp, own, x2))) {
+			int value = solve1(own & ~flips, opp | flips | (1ULL << x2), x1);
+			if (best == -65 || value < best) {
+				best = value;
+			}
+		}
+		if (best == -65) {
+			return finalScore(own, opp);
+		}
+	}
+	return best;
+}
+
+int Endgame::solve1(uint64_t own, uint64_t opp, int x) {
+	// With 63 discs down the disc difference is odd, and the last square goes to whoever can take it
+	int difference = 2 * Bitboard::Count(own) - 63;
+	uint64_t flips = Bitboard::Flips(own, opp, x);
+	if (flips) {
+		return difference + 1 + 2 * Bitboard::Count(flips);
+	}
+	flips = Bitboard::Flips(opp, own, x);
+	if (flips) {
+		return difference - 1 - 2 * Bitboard::Count(flips);
+	}
+	// Nobody can move, so the empty square goes to the winner
+	return difference > 0 ? difference + 1 : difference - 1;
+}
@@ -0,0 +1,84 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include "Utils.h"
+#include "SearchContext.h"
+
+#include <cstdint>
+
+// Exact endgame solver: searches to the end of the game and scores positions by final disc difference
+// (empty squares go to the winner), instead of stopping at a depth and using the heuristic
+class Endgame {
+
+public:
+
+	// Positions with at most this many empty squares are solved exactly,
+	// and those with at most wldEmpties are solved for win/loss/draw only
+	static int exactEmpties;
+	static int wldEmpties;
+
+	// Solves the state for the player to move, setting the best move's square and its score
+	// (the final disc difference, or just -1/0/1 for a win/loss/draw search); returns false if the context
+	// timed out or the solve went past its node limit first, in which case the move is the best of the moves that were finished
+	static bool SolveRoot(GameState, bool wld, SearchContext *, int * bestSquare, int * score, long long * nodes);
+
+	// Final disc difference for the player to move, searched with a fail-soft alpha-beta window
+	static int Solve(GameState, int, int, SearchContext *, long long * nodes);
+
+private:
+
+	// Per-search bookkeeping; the clock and node limit are next checked once nodes reaches nextCheck
+	struct Search {
+		SearchContext * context;
+		long long nodes;
+		bool aborted;
+		long long nodeLimit;
+		long long nextCheck;
+	};
+
+	// Number of nodes between checks of the clock and the node limit
+	static const int TIME_CHECK_INTERVAL = 4096;
+
+	// Counts a node, checking the clock and the node limit every so often; returns true once the search has to give up
+	static inline bool countNode(Search * search) {
+		if (++search->nodes >= search->nextCheck) {
+			search->nextCheck = search->nodes + TIME_CHECK_INTERVAL;
+			if (search->nodeLimit && search->nextCheck > search->nodeLimit) {
+				search->nextCheck = search->nodeLimit;
+			}
+			if (search->context && (search->context->CheckClock() || (search->nodeLimit && search->nodes >= search->nodeLimit))) {
+				search->aborted = true;
+			}
+		}
+		return search->aborted;
+	}
+
+	// Above this many empties moves are sorted by the opponent's resulting mobility (fastest first);
+	// below it by parity, which is cheaper
+	static const int FASTEST_FIRST_EMPTIES = 6;
+
+	// Transposition table lookups only pay for themselves this far from the end
+	static const int TABLE_EMPTIES = 7;
+
+	// Kept apart from midgame entries in the shared transposition table, which have heuristic scores
+	static const uint64_t TABLE_KEY = 0x5d6ea4c1f2b3a987ULL;
+
+	static int solveDeep(uint64_t, uint64_t, int, int, int, bool, Search *);
+	static int solve4(uint64_t, uint64_t, int, int, int, int, int, int, Search *);
+	static int solve3(uint64_t, uint64_t, int, int, int, int, int, Search *);
+	static int solve2(uint64_t, uint64_t, int, int, int, int, Search *);
+	static int solve1(uint64_t, uint64_t, int);
+
+	// Score of a finished game; empty squares go to the winner
+	static int finalScore(uint64_t, uint64_t);
+
+	// Sorts moves so that the ones most likely to be best come first
+	static int orderMoves(uint64_t, uint64_t, uint64_t, int, int, int *);
+
+	// The four 4x4 quadrants, used for parity
+	static const uint64_t quadrantMask[4];
+	static int quadrant(int square) { return ((square >> 4) & 2) | ((square >> 2) & 1); }
+
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include <algorithm>
+
+#include "EngineHost.h"
+#include "Bitboard.h"
+#include "Game.h"
+
+EngineHost::EngineHost(int threads) : sequence(0), freeThreads(std::max(1, threads)), stopping(false),
+	generation(0), generationStart(std::chrono::steady_clock::now()), currentSearches(0), olderSearches(0) {
+	for (int i = 0; i < freeThreads; ++i) {
+		workers.push_back(std::thread(&EngineHost::workerLoop, this));
+	}
+}
+
+EngineHost::~EngineHost() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+		queue.clear();
+		for (std::map<int, std::unique_ptr<HostedGame> >::iterator i = games.begin(); i != games.end(); ++i) {
+			i->second->player.Stop();
+		}
+	}
+	workAdded.notify_all();
+	for (unsigned int i = 0; i < workers.size(); ++i) {
+		workers[i].join();
+	}
+}
+
+bool EngineHost::NewGame(int game, const TimeControl & control) {
+	std::lock_guard<std::mutex> guard(lock);
+	std::unique_ptr<HostedGame> & hosted = games[game];
+	if (!hosted) {
+		// A game that is started over keeps its player, and with it the move ordering data
+		hosted.reset(new HostedGame());
+		hosted->player.SetId(game);
+		hosted->player.SetAgesTable(false);
+		hosted->busy = false;
+		hosted->stopped = false;
+	} else if (hosted->busy) {
+		return false;
+	}
+	hosted->player.SetTimeControl(control.moveSeconds, control.gameSeconds);
+	hosted->player.SetLimits(control.depth, control.nodes);
+	hosted->player.NewGame();
+	return true;
+}
+
+bool EngineHost::EndGame(int game) {
+	std::lock_guard<std::mutex> guard(lock);
+	std::map<int, std::unique_ptr<HostedGame> >::iterator i = games.find(game);
+	if (i == games.end() || i->second->busy) {
+		return false;
+	}
+	games.erase(i);
+	return true;
+}
+
+bool EngineHost::RequestMove(int game, GameState state, const Callback & callback) {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::lock_guard<std::mutex> guard(lock);
+	std::map<int, std::unique_ptr<HostedGame> >::iterator i = games.find(game);
+	if (i == games.end() || i->second->busy || !Bitboard::Moves(state.own, state.opp)) {
+		return false;
+	}
+
+	// Nothing is searching for the game, so its player can be asked about its time here
+	double budget = i->second->player.MoveBudget(state);
+	Request request;
+	request.game = game;
+	request.state = state;
+	request.requested = now;
+	request.deadline = budget > 0
+		? now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget))
+		: std::chrono::steady_clock::time_point::max();
+	request.sequence = sequence++;
+	request.callback = callback;
+	queue.push_back(request);
+	std::push_heap(queue.begin(), queue.end(), Later());
+
+	i->second->busy = true;
+	i->second->stopped = false;
+	workAdded.notify_one();
+	return true;
+}
+
+bool EngineHost::Stop(int game) {
+	std::lock_guard<std::mutex> guard(lock);
+	std::map<int, std::unique_ptr<HostedGame> >::iterator i = games.find(game);
+	if (i == games.end() || !i->second->busy) {
+		return false;
+	}
+
+	// A request still waiting gets its stop when a thread takes it up
+	i->second->stopped = true;
+	i->second->player.Stop();
+	return true;
+}
+
+bool EngineHost::Busy(int game) {
+	std::lock_guard<std::mutex> guard(lock);
+	std::map<int, std::unique_ptr<HostedGame> >::iterator i = games.find(game);
+	return i != games.end() && i->second->busy;
+}
+
+int EngineHost::Games() {
+	std::lock_guard<std::mutex> guard(lock);
+	return games.size();
+}
+
+void EngineHost::workerLoop() {
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		while (!stopping && (queue.empty() || !freeThreads)) {
+			workAdded.wait(guard);
+		}
+		if (stopping) {
+			return;
+		}
+
+		std::pop_heap(queue.begin(), queue.end(), Later());
+		Request request = queue.back();
+		queue.pop_back();
+
+		// Every request still waiting will need a thread; the spare ones beyond that are split with whatever comes in next
+		int spare = freeThreads - 1 - (int) queue.size();
+		int threads = 1 + std::max(0, spare / 2);
+		freeThreads -= threads;
+
+		advanceGeneration();
+		long long searchGeneration = generation;
+		++currentSearches;
+
+		HostedGame * game = games[request.game].get();
+		game->player.SetThreads(threads);
+		if (game->stopped) {
+			game->player.Stop();
+		} else {
+			game->player.ClearStop();
+		}
+		game->stopped = false;
+		guard.unlock();
+
+		Location move = game->player.MakeMove(request.state, request.requested);
+		const SearchStats * stats = game->player.LastStats();
+		Result result;
+		result.game = request.game;
+		result.square = move.square;
+		result.score = stats->score;
+		result.depth = stats->depth;
+		result.nodes = stats->nodes;
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - request.requested).count();
+
+		// The game is free again before the answer goes out, so that whoever gets it can ask for the next move straight away
+		guard.lock();
+		game->busy = false;
+		freeThreads += threads;
+		if (searchGeneration == generation) {
+			--currentSearches;
+		} else {
+			--olderSearches;
+		}
+		advanceGeneration();
+		workAdded.notify_all();
+		guard.unlock();
+		request.callback(result);
+		guard.lock();
+	}
+}
+
+void EngineHost::advanceGeneration() {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (olderSearches || now - generationStart < std::chrono::milliseconds(GENERATION_MILLISECONDS)) {
+		return;
+	}
+	Game::transpositionTable.NewSearch();
+	++generation;
+	generationStart = now;
+	olderSearches = currentSearches;
+	currentSearches = 0;
+}
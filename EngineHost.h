@@ -0,0 +1,137 @@
+#ifndef ENGINEHOST_H
+#define ENGINEHOST_H
+
+#include "Utils.h"
+#include "Player.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs the engine's side of many independent games in one process. Each game has its own player, with its
+// own time control, move ordering data and clock, while all of them share the transposition table (whose
+// size bounds the memory used, however many games there are) and the book and position cache.
+//
+// Move requests are searched by a fixed number of threads, earliest deadline first: a request's deadline is
+// when it was made plus the time its game's control gives the move, and the time it spends waiting counts
+// against that. When there are more threads than requests, a request also gets up to half of the spare ones
+// to search with, which leaves the rest for requests that come in while it's being searched. Games with a
+// depth or node limit have no deadline and go after every timed request.
+// The players don't age the shared table themselves, as a move in one game would make the entries of
+// every other game's running search look old. The host starts a new generation instead once every search
+// running at the start of the current one has finished, and no more than once a second: a running search's
+// entries are never more than a generation behind, and the table's age takes minutes to wrap around.
+// Pondering is left to the process-wide setting, which should be off, as a pondering player would be
+// searching without a thread of the pool
+class EngineHost {
+
+public:
+
+	// How a game's moves are limited: seconds per move, or for the whole game when gameSeconds is above 0;
+	// or, instead of any time, a depth or a number of nodes
+	struct TimeControl {
+		double moveSeconds;
+		double gameSeconds;
+		int depth;
+		long long nodes;
+
+		TimeControl() : moveSeconds(10), gameSeconds(0), depth(0), nodes(0) { }
+	};
+
+	// The answer to a move request
+	struct Result {
+		int game;
+		int square;
+		double score; // As in SearchStats, from the point of view of the player to move
+		int depth;
+		long long nodes;
+		double seconds; // Since the request, including the wait for a thread
+	};
+
+	// Called on the thread that searched the move, once it has been chosen
+	typedef std::function<void(const Result &)> Callback;
+
+	explicit EngineHost(int threads);
+
+	// Stops the searches that are running (their callbacks are still called) and drops the requests still waiting
+	~EngineHost();
+
+	// Starts a game under the id, or starts it over with a new control; returns false if it has a move request outstanding
+	bool NewGame(int game, const TimeControl &);
+
+	// Forgets a game; returns false if there's no such game or it has a move request outstanding
+	bool EndGame(int game);
+
+	// Asks for a move in the game, for the player to move in the state. Returns false if there's no such game,
+	// it already has a request outstanding, or the player to move has no legal move
+	bool RequestMove(int game, GameState, const Callback &);
+
+	// Has a running or waiting request for the game answered as soon as possible; returns false if there isn't one
+	bool Stop(int game);
+
+	// Whether the game has a move request outstanding
+	bool Busy(int game);
+
+	int Games();
+
+private:
+
+	struct HostedGame {
+		ComputerPlayer player;
+		bool busy; // Has a request waiting or being searched
+		bool stopped; // Stop was called before its request was searched
+	};
+
+	struct Request {
+		int game;
+		GameState state;
+		std::chrono::steady_clock::time_point requested;
+		std::chrono::steady_clock::time_point deadline;
+		long long sequence; // Breaks ties in the order the requests came in
+		Callback callback;
+	};
+
+	// For a heap with the earliest deadline on top
+	struct Later {
+		bool operator()(const Request & a, const Request & b) const {
+			return a.deadline != b.deadline ? a.deadline > b.deadline : a.sequence > b.sequence;
+		}
+	};
+
+	// Guards everything below; the players themselves are only touched by the thread searching for them
+	std::mutex lock;
+	std::condition_variable workAdded;
+	std::map<int, std::unique_ptr<HostedGame> > games;
+	std::vector<Request> queue;
+	long long sequence;
+	int freeThreads;
+	bool stopping;
+
+	// The table's generations (see advanceGeneration): how many there have been, when the current one began,
+	// and how many running searches started in it and in the one before
+	long long generation;
+	std::chrono::steady_clock::time_point generationStart;
+	int currentSearches;
+	int olderSearches;
+
+	static const int GENERATION_MILLISECONDS = 1000;
+
+	std::vector<std::thread> workers;
+
+	void workerLoop();
+
+	// Starts a new generation in the transposition table if the searches of the one before have all finished
+	// and the current one is old enough; must be called with the lock held
+	void advanceGeneration();
+
+	EngineHost(const EngineHost &);
+	EngineHost & operator=(const EngineHost &);
+
+};
+
+#endif
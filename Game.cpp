@@ -5,9 +5,15 @@
 #include <sstream>
 #include <algorithm>
 #include <climits>
-#include <ctime>
+#include <cmath>
+#include <limits>
 
 #include "Game.h"
+#include "Bitboard.h"
+#include "SearchPool.h"
+#include "AllocationCounter.h"
+#include "Heuristic.h"
+#include "ProbCut.h"
 
 using std::cout;
 using std::endl;
@@ -15,6 +21,10 @@ using std::vector;
 using std::string;
 
 int Game::timeLimit = 10; // Set default time limit to 10 seconds
+TranspositionTable Game::transpositionTable;
+OpeningBook Game::openingBook;
+GameArchive Game::archive;
+PositionCache Game::positionCache;
 
 Game::Game(Player * p1, Player * p2, int limit) {
 	isOver = false;
@@ -25,7 +35,10 @@ Game::Game(Player * p1, Player * p2, int limit) {
 	Game::timeLimit = limit;
 
 	currentPlayer = player1;
-	currentState = GameState(p1->GetId(), p2->GetId());
+	currentState = GameState::Start();
+
+	record.start = currentState;
+	record.firstPlayer = 1;
 }
 
 Game::Game(Player * p1, Player * p2, int limit, GameState state, int currentId) {
@@ -36,21 +49,7 @@ Game::Game(Player * p1, Player * p2, int limit, GameState state, int currentId)
 	player2 = p2;
 	Game::timeLimit = limit;
 
-	// Repopulate current state with correct ids
-	int newBoard[8][8];
-	for (int i = 0; i < 8; ++i) {
-		for (int j = 0; j < 8; ++j) {
-			if (state.board[i][j] == 1) {
-				newBoard[i][j] = player1->GetId();
-			} else if (state.board[i][j] == 2) {
-				newBoard[i][j] = player2->GetId();
-			} else {
-				newBoard[i][j] = 0;
-			}
-		}
-	}
-
-	currentState = GameState(newBoard);
+	currentState = state;
 
 	if (currentId == 1) {
 		currentPlayer = player1;
@@ -59,6 +58,9 @@ Game::Game(Player * p1, Player * p2, int limit, GameState state, int currentId)
 	} else {
 		currentPlayer = player1; // Default to player 1 if invalid
 	}
+
+	record.start = currentState;
+	record.firstPlayer = currentPlayer == player1 ? 1 : 2;
 }
 
 void Game::PrintBoard() {
@@ -70,6 +72,9 @@ void Game::PrintBoard() {
 	static char rowDivider[] = "   \033[40;32;2;7m|____||____||____||____||____||____||____||____|";
 	static char blankRow[] = "   \033[40;32;2;7m|    ||    ||    ||    ||    ||    ||    ||    |";
 
+	uint64_t player1Discs = discsOf(player1);
+	uint64_t player2Discs = discsOf(player2);
+
 	cout << endl << "Current board: " << endl << endl;
 	cout << blankTile << "              " << endl;
 	cout << "Player 1 is " << noColor << player1Tile << blankTile << endl;
@@ -83,14 +88,13 @@ void Game::PrintBoard() {
 		cout << " " << i << " ";
 		for (int j = 0; j < 8; ++j) {
 			cout << tileColor << "| ";
-			if (currentState.board[i][j] == player1->GetId()) {
+			uint64_t bit = Bitboard::SquareBit(i, j);
+			if (player1Discs & bit) {
 				cout << noColor << player1Tile;
-			} else if (currentState.board[i][j] == player2->GetId()) {
+			} else if (player2Discs & bit) {
 				cout << noColor << player2Tile;
-			} else if (currentState.board[i][j] == 0) {
-				cout << blankTile << blankTile;
 			} else {
-				cout << "??";
+				cout << blankTile << blankTile;
 			}
 			cout << tileColor << " |";
 		}
@@ -114,7 +118,7 @@ void Game::Move() {
 
 	// Display all legal moves
 	std::cout << "Legal moves:" << std::endl;
-	std::vector<Location> legalMoves = Game::LegalMoves(currentState, currentPlayer->GetId());
+	std::vector<Location> legalMoves = Game::LegalMoves(currentState);
 	for (unsigned int i = 0; i < legalMoves.size(); ++i) {
 		std::cout << legalMoves[i] << std::endl;
 	}
@@ -124,9 +128,23 @@ void Game::Move() {
 		// Check for game end
 		if (lastSkipped) {
 			isOver = true;
+			player1->StopThinking();
+			player2->StopThinking();
+			if (archive.IsOpen()) {
+				// The first player's disc difference, with the empty squares going to the winner
+				Player * first = record.firstPlayer == 1 ? player1 : player2;
+				int own = Bitboard::Count(discsOf(first));
+				int opp = Bitboard::Count(discsOf(first == player1 ? player2 : player1));
+				int empties = 64 - own - opp;
+				record.result = own - opp + (own > opp ? empties : (own < opp ? -empties : 0));
+				if (!archive.Append(record)) {
+					cout << "Could not add the game to the archive" << endl;
+				}
+			}
 		} else {
 			cout << "No legal moves available; skipping turn" << endl;
 			lastSkipped = true;
+			currentState = GameState::Pass(currentState);
 			currentPlayer = enemyPlayer;
 		}
 		return;
@@ -139,212 +157,48 @@ void Game::Move() {
 	// Get move from player; legality is checked here, so we will always get a legal move
 	Location move = currentPlayer->MakeMove(currentState);
 	cout << "Chosen move: " << move << endl;
+	history.push_back(currentState);
+	record.AddMove(move.square, currentPlayer->LastStats());
 
 	// Get changed pieces
-	vector<Location> changedPieces = GetChangedPieces(currentState, move, currentPlayer->GetId(), enemyPlayer->GetId());
+	uint64_t changedPieces = GetChangedPieces(currentState, move);
 
-	// Update state
-	currentState = GameState::ApplyMove(currentState, changedPieces, currentPlayer->GetId());
+	// Update state (which is now seen from the enemy's side)
+	currentState = GameState::ApplyMove(currentState, changedPieces);
 
 	// Switch player
 	currentPlayer = enemyPlayer;
 }
 
-vector<Location> Game::GetChangedPieces(GameState state, Location move, int currentId, int enemyId) {
-	// Compile a vector of all converted pieces
-	vector<Location> changedPieces;
-	changedPieces.push_back(move);
-
-	// Check each direction for flanked enemies and add each one to changePieces
-
-	vector<Location> adjacentEnemies = getAdjacentLocations(state, move, enemyId);
-	for (unsigned int i = 0; i < adjacentEnemies.size(); ++i) {
-		// We can include duplicates here since checking for them is simply less efficient than processing them twice (without repercussions)
-
-		// Check direction of adjacent square
-		if (adjacentEnemies[i].extras == "RIGHT") {
-			// Create temporary vector to keep track of valid pieces
-			vector<Location> tmpLocs;
-			tmpLocs.push_back(adjacentEnemies[i]);
-
-			// Enemy on the right, keep checking right
-			int tmp = adjacentEnemies[i].column + 1;
-			while (tmp < 8) {
-				if (state.board[move.row][tmp] == 0) {
-					break;
-				} else if (state.board[move.row][tmp] == enemyId) {
-					tmpLocs.push_back(Location(move.row, tmp));
-				} else if (state.board[move.row][tmp] == currentId) {
-					for (unsigned int j = 0; j < tmpLocs.size(); ++j) {
-						changedPieces.push_back(tmpLocs[j]);
-					}
-					break;
-				}
-				++tmp;
-			}
-		} else if (adjacentEnemies[i].extras == "DOWNRIGHT") {
-			// Create temporary vector to keep track of valid pieces
-			vector<Location> tmpLocs;
-			tmpLocs.push_back(adjacentEnemies[i]);
-
-			// Empty on down right, keep checking down right
-			int tmp1 = adjacentEnemies[i].row + 1, tmp2 = adjacentEnemies[i].column + 1;
-			while (tmp1 < 8 && tmp2 < 8) {
-				if (state.board[tmp1][tmp2] == 0) {
-					break;
-				} else if (state.board[tmp1][tmp2] == enemyId) {
-					tmpLocs.push_back(Location(tmp1, tmp2));
-				} else if (state.board[tmp1][tmp2] == currentId) {
-					for (unsigned int j = 0; j < tmpLocs.size(); ++j) {
-						changedPieces.push_back(tmpLocs[j]);
-					}
-					break;
-				}
-				++tmp1;
-				++tmp2;
-			}
-		} else if (adjacentEnemies[i].extras == "DOWN") {
-			// Create temporary vector to keep track of valid pieces
-			vector<Location> tmpLocs;
-			tmpLocs.push_back(adjacentEnemies[i]);
-
-			// Enemy on the down, keep checking down
-			int tmp = adjacentEnemies[i].row + 1;
-			while (tmp < 8) {
-				if (state.board[tmp][move.column] == 0) {
-					break;
-				} else if (state.board[tmp][move.column] == enemyId) {
-					tmpLocs.push_back(Location(tmp, move.column));
-				} else if (state.board[tmp][move.column] == currentId) {
-					for (unsigned int j = 0; j < tmpLocs.size(); ++j) {
-						changedPieces.push_back(tmpLocs[j]);
-					}
-					break;
-				}
-				++tmp;
-			}
-		} else if (adjacentEnemies[i].extras == "DOWNLEFT") {
-			// Create temporary vector to keep track of valid pieces
-			vector<Location> tmpLocs;
-			tmpLocs.push_back(adjacentEnemies[i]);
-
-			// Empty on down left, keep checking down left
-			int tmp1 = adjacentEnemies[i].row + 1, tmp2 = adjacentEnemies[i].column - 1;
-			while (tmp1 < 8 && tmp2 >= 0) {
-				if (state.board[tmp1][tmp2] == 0) {
-					break;
-				} else if (state.board[tmp1][tmp2] == enemyId) {
-					tmpLocs.push_back(Location(tmp1, tmp2));
-				} else if (state.board[tmp1][tmp2] == currentId) {
-					for (unsigned int j = 0; j < tmpLocs.size(); ++j) {
-						changedPieces.push_back(tmpLocs[j]);
-					}
-					break;
-				}
-				++tmp1;
-				--tmp2;
-			}
-		} else if (adjacentEnemies[i].extras == "LEFT") {
-			// Create temporary vector to keep track of valid pieces
-			vector<Location> tmpLocs;
-			tmpLocs.push_back(adjacentEnemies[i]);
-
-			// Enemy on the left, keep checking left
-			int tmp = adjacentEnemies[i].column - 1;
-			while (tmp >= 0) {
-				if (state.board[move.row][tmp] == 0) {
-					break;
-				} else if (state.board[move.row][tmp] == enemyId) {
-					tmpLocs.push_back(Location(move.row, tmp));
-				} else if (state.board[move.row][tmp] == currentId) {
-					for (unsigned int j = 0; j < tmpLocs.size(); ++j) {
-						changedPieces.push_back(tmpLocs[j]);
-					}
-					break;
-				}
-				--tmp;
-			}
-		} else if (adjacentEnemies[i].extras == "UPLEFT") {
-			// Create temporary vector to keep track of valid pieces
-			vector<Location> tmpLocs;
-			tmpLocs.push_back(adjacentEnemies[i]);
-
-			// Empty on up left, keep checking up left
-			int tmp1 = adjacentEnemies[i].row - 1, tmp2 = adjacentEnemies[i].column - 1;
-			while (tmp1 >= 0 && tmp2 >= 0) {
-				if (state.board[tmp1][tmp2] == 0) {
-					break;
-				} else if (state.board[tmp1][tmp2] == enemyId) {
-					tmpLocs.push_back(Location(tmp1, tmp2));
-				} else if (state.board[tmp1][tmp2] == currentId) {
-					for (unsigned int j = 0; j < tmpLocs.size(); ++j) {
-						changedPieces.push_back(tmpLocs[j]);
-					}
-					break;
-				}
-				--tmp1;
-				--tmp2;
-			}
-		} else if (adjacentEnemies[i].extras == "UP") {
-			// Create temporary vector to keep track of valid pieces
-			vector<Location> tmpLocs;
-			tmpLocs.push_back(adjacentEnemies[i]);
-
-			// Enemy on the down, keep checking down
-			int tmp = adjacentEnemies[i].row - 1;
-			while (tmp >= 0) {
-				if (state.board[tmp][move.column] == 0) {
-					break;
-				} else if (state.board[tmp][move.column] == enemyId) {
-					tmpLocs.push_back(Location(tmp, move.column));
-				} else if (state.board[tmp][move.column] == currentId) {
-					for (unsigned int j = 0; j < tmpLocs.size(); ++j) {
-						changedPieces.push_back(tmpLocs[j]);
-					}
-					break;
-				}
-				--tmp;
-			}
-		} else if (adjacentEnemies[i].extras == "UPRIGHT") {
-			// Create temporary vector to keep track of valid pieces
-			vector<Location> tmpLocs;
-			tmpLocs.push_back(adjacentEnemies[i]);
-
-			// Empty on up right, keep checking up right
-			int tmp1 = adjacentEnemies[i].row - 1, tmp2 = adjacentEnemies[i].column + 1;
-			while (tmp1 >= 0 && tmp2 < 8) {
-				if (state.board[tmp1][tmp2] == 0) {
-					break;
-				} else if (state.board[tmp1][tmp2] == enemyId) {
-					tmpLocs.push_back(Location(tmp1, tmp2));
-				} else if (state.board[tmp1][tmp2] == currentId) {
-					for (unsigned int j = 0; j < tmpLocs.size(); ++j) {
-						changedPieces.push_back(tmpLocs[j]);
-					}
-					break;
-				}
-				--tmp1;
-				++tmp2;
-			}
-		}
+uint64_t Game::GetChangedPieces(GameState state, Location move) {
+	// The move itself plus every enemy disc flanked along any of the 8 directions
+	int square = move.square;
+	return (1ULL << square) | Bitboard::Flips(state.own, state.opp, square);
+}
+
+std::vector<int> Game::PrincipalVariation(GameState state, Location move, int length, bool pruned) {
+	vector<int> line;
+	int square = move.square;
+	while ((int) line.size() < length && square != TranspositionTable::NO_MOVE && (Bitboard::Moves(state.own, state.opp) & (1ULL << square))) {
+		line.push_back(square);
+		state = GameState::ApplyMove(state, GetChangedPieces(state, Location::FromSquare(square)));
 
+		TranspositionTable::Entry entry;
+		int symmetry;
+		uint64_t key = TranspositionTable::Key(state, pruned, &symmetry);
+		square = transpositionTable.Probe(key, &entry) ? TranspositionTable::MoveFromKey(entry.move, symmetry) : TranspositionTable::NO_MOVE;
 	}
+	return line;
+}
 
-	return changedPieces;
+uint64_t Game::discsOf(Player * player) {
+	return player == currentPlayer ? currentState.own : currentState.opp;
 }
 
 void Game::PrintResults() {
 	// Compile statistics
-	int player1Count = 0, player2Count = 0;
-	for (int i = 0; i < 8; ++i) {
-		for (int j = 0; j < 8; ++j) {
-			if (currentState.board[i][j] == player1->GetId()) {
-				++player1Count;
-			} else if (currentState.board[i][j] == player2->GetId()) {
-				++player2Count;
-			}
-		}
-	}
+	int player1Count = Bitboard::Count(discsOf(player1));
+	int player2Count = Bitboard::Count(discsOf(player2));
 
 	// Display results
 	cout << "Game over!" << endl;
@@ -352,148 +206,14 @@ void Game::PrintResults() {
 	cout << player1Count << " - " << player2Count << endl;
 }
 
-std::vector<Location> Game::LegalMoves(GameState state, int id) {
+std::vector<Location> Game::LegalMoves(GameState state) {
 	vector<Location> validLocations;
 
-	// Populate vectors of player locations and enemy locations
-	vector<Location> playerLocations, enemyLocations;
-	for (int i = 0; i < 8; ++i) {
-		for (int j = 0; j < 8; ++j) {
-			if (state.board[i][j] == id) {
-				playerLocations.push_back(Location(i, j));
-			} else if (state.board[i][j] && state.board[i][j] != id) {
-				enemyLocations.push_back(Location(i, j));
-			}
-		}
-	}
-
-	// LEGAL MOVES ALGORITHM:
-	// For each enemy location
-	//     Find adjacent open squares
-	//	   For each adjacent open square
-	//	       Check if that square is flanked by another friendly piece incident upon the current enemy piece
-	for (unsigned int i = 0; i < enemyLocations.size(); ++i) {
-		// Get adjacent locations
-		vector<Location> emptyAdjacent = getAdjacentLocations(state, enemyLocations[i], 0);
-
-		for (unsigned int j = 0; j < emptyAdjacent.size(); ++j) {
-			// Don't check location if previously verified as valid
-			if (std::find(validLocations.begin(), validLocations.end(), emptyAdjacent[j]) != validLocations.end()) {
-				continue;
-			}
-
-			// Check direction of adjacent square
-			if (emptyAdjacent[j].extras == "RIGHT") {
-				// Empty on right, check squares to the left
-				int tmp = enemyLocations[i].column - 1;
-				while (tmp >= 0) {
-					if (state.board[emptyAdjacent[j].row][tmp] == 0) {
-						break;
-					}
-					if (state.board[emptyAdjacent[j].row][tmp] == id) {
-						validLocations.push_back(emptyAdjacent[j]);
-						break;
-					}
-					--tmp;
-				}
-			} else if (emptyAdjacent[j].extras == "DOWNRIGHT") {
-				// Empty on down right, check squares to the up left
-				int tmp1 = enemyLocations[i].row - 1, tmp2 = enemyLocations[i].column - 1;
-				while (tmp1 >= 0 && tmp2 >= 0) {
-					if (state.board[tmp1][tmp2] == 0) {
-						break;
-					}
-					if (state.board[tmp1][tmp2] == id) {
-						validLocations.push_back(emptyAdjacent[j]);
-						break;
-					}
-					--tmp1;
-					--tmp2;
-				}
-			} else if (emptyAdjacent[j].extras == "DOWN") {
-				// Empty on down, check squares to the up
-				int tmp = enemyLocations[i].row - 1;
-				while (tmp >= 0) {
-					if (state.board[tmp][emptyAdjacent[j].column] == 0) {
-						break;
-					}
-					if (state.board[tmp][emptyAdjacent[j].column] == id) {
-						validLocations.push_back(emptyAdjacent[j]);
-						break;
-					}
-					--tmp;
-				}
-			} else if (emptyAdjacent[j].extras == "DOWNLEFT") {
-				// Empty on down left, check squares to the up right
-				int tmp1 = enemyLocations[i].row - 1, tmp2 = enemyLocations[i].column + 1;
-				while (tmp1 >= 0 && tmp2 < 8) {
-					if (state.board[tmp1][tmp2] == 0) {
-						break;
-					}
-					if (state.board[tmp1][tmp2] == id) {
-						validLocations.push_back(emptyAdjacent[j]);
-						break;
-					}
-					--tmp1;
-					++tmp2;
-				}
-			} else if (emptyAdjacent[j].extras == "LEFT") {
-				// Empty on left, check squares to the right
-				int tmp = enemyLocations[i].column + 1;
-				while (tmp < 8) {
-					if (state.board[emptyAdjacent[j].row][tmp] == 0) {
-						break;
-					}
-					if (state.board[emptyAdjacent[j].row][tmp] == id) {
-						validLocations.push_back(emptyAdjacent[j]);
-						break;
-					}
-					++tmp;
-				}
-			} else if (emptyAdjacent[j].extras == "UPLEFT") {
-				// Empty on up left, check squares to the down right
-				int tmp1 = enemyLocations[i].row + 1, tmp2 = enemyLocations[i].column + 1;
-				while (tmp1 < 8 && tmp2 < 8) {
-					if (state.board[tmp1][tmp2] == 0) {
-						break;
-					}
-					if (state.board[tmp1][tmp2] == id) {
-						validLocations.push_back(emptyAdjacent[j]);
-						break;
-					}
-					++tmp1;
-					++tmp2;
-				}
-			} else if (emptyAdjacent[j].extras == "UP") {
-				// Empty on up, check squares to the down
-				int tmp = enemyLocations[i].row + 1;
-				while (tmp < 8) {
-					if (state.board[tmp][emptyAdjacent[j].column] == 0) {
-						break;
-					}
-					if (state.board[tmp][emptyAdjacent[j].column] == id) {
-						validLocations.push_back(emptyAdjacent[j]);
-						break;
-					}
-					++tmp;
-				}
-			} else if (emptyAdjacent[j].extras == "UPRIGHT") {
-				// Empty on up right, check squares to the down left
-				int tmp1 = enemyLocations[i].row + 1, tmp2 = enemyLocations[i].column - 1;
-				while (tmp1 < 8 && tmp2 >= 0) {
-					if (state.board[tmp1][tmp2] == 0) {
-						break;
-					}
-					if (state.board[tmp1][tmp2] == id) {
-						validLocations.push_back(emptyAdjacent[j]);
-						break;
-					}
-					++tmp1;
-					--tmp2;
-				}
-			}
-
-		}
+	uint64_t moves = Bitboard::Moves(state.own, state.opp);
+	while (moves) {
+		int square = Bitboard::FirstSquare(moves);
+		validLocations.push_back(Location::FromSquare(square));
+		moves &= moves - 1;
 	}
 
 	return validLocations;
@@ -515,7 +235,6 @@ Game Game::FromFile(string fileName, bool player1Human, bool player2Human) {
 			b[i][j] = a;
 		}
 	}
-	GameState state(b);
 
 	string line;
 	std::getline(file, line);
@@ -531,6 +250,9 @@ Game Game::FromFile(string fileName, bool player1Human, bool player2Human) {
 
 	file.close();
 
+	// The state is kept from the point of view of the player to move
+	GameState state(b, currentPlayerId == 2 ? 2 : 1, currentPlayerId == 2 ? 1 : 2);
+
 	Player * p1 = new ComputerPlayer();
 	Player * p2 = new ComputerPlayer();
 	if (player1Human) {
@@ -543,256 +265,271 @@ Game Game::FromFile(string fileName, bool player1Human, bool player2Human) {
 	return Game(p1, p2, time, state, currentPlayerId);
 }
 
-vector<Location> Game::getAdjacentLocations(GameState state, Location l, int id) {
-	vector<Location> adjacent;
+MoveVal Game::MinimaxSearch(GameState state, double min, double max, int depth, int maxDepth, SearchContext * context, const Pattern::Features * features) {
+	NoAllocationCheck allocationCheck("Game::MinimaxSearch");
+
+	// Conditionally increment depthTracker
+	if (depth > context->depthTracker) {
+		++context->depthTracker;
+	}
+
+	// Check if timed out
+	context->CountNode();
+	bool timedOut = context->TimedOut();
+
+	// Determine whether the current state is a max node or a min node based on depth
+	bool maxNode = (depth) % 2 == 0; // Since we are starting at max states, even depth means we are at a max node
 
-	if (l.row > 0) {
-		if (state.board[l.row - 1][l.column] == id) {
-			adjacent.push_back(Location(l.row - 1, l.column, "UP"));
+	// With pattern weights loaded, the pattern numbers are passed down and updated move by move
+	Pattern::Features rootFeatures;
+	if (!features && Pattern::Loaded()) {
+		Pattern::Compute(state, maxNode, &rootFeatures);
+		features = &rootFeatures;
+	}
+
+	// Check the transposition table for a previous search of this state; leaves are cheaper to evaluate than to look up.
+	// The stored best move is tried first, and if the stored search was deep enough we can use its score
+	// (except at the root, which is always searched so that we get a move back)
+	int remainingDepth = maxDepth - depth;
+	bool useTable = remainingDepth > 0 && !timedOut;
+	uint64_t key = 0;
+	int symmetry = 0;
+	bool pruned = context->probCut && ProbCut::Loaded();
+	PositionCache::Kind cacheKind = pruned ? PositionCache::PRUNED_SEARCH : PositionCache::SEARCH;
+	int hashMove = TranspositionTable::NO_MOVE;
+	if (useTable) {
+		key = TranspositionTable::Key(state, pruned, &symmetry);
+		TranspositionTable::Entry entry;
+		bool found = transpositionTable.Probe(key, &entry);
+		++context->tableProbes;
+		if (found) {
+			++context->tableHits;
+			hashMove = TranspositionTable::MoveFromKey(entry.move, symmetry);
 		}
 
-		if (l.column > 0) {
-			if (state.board[l.row - 1][l.column - 1] == id) {
-				adjacent.push_back(Location(l.row - 1, l.column - 1, "UPLEFT"));
+		// Deep nodes that the table can't settle are looked up in the persistent cache too; what it has
+		// goes into the table, so that transpositions and later iterations find it there
+		if (remainingDepth >= PositionCache::MIN_DEPTH && positionCache.IsOpen() && (!found || entry.depth < remainingDepth)) {
+			PositionCache::Entry cached;
+			if (positionCache.Probe(state, cacheKind, &cached) && (!found || cached.depth > entry.depth)) {
+				++context->cacheHits;
+				transpositionTable.Store(key, cached.depth, cached.bound, cached.score, TranspositionTable::MoveToKey(cached.move, symmetry));
+				found = true;
+				entry.score = cached.score;
+				entry.depth = cached.depth;
+				entry.bound = cached.bound;
+				if (cached.move != TranspositionTable::NO_MOVE) {
+					hashMove = cached.move;
+				}
 			}
 		}
-		if (l.column < 7) {
-			if (state.board[l.row - 1][l.column + 1] == id) {
-				adjacent.push_back(Location(l.row - 1, l.column + 1, "UPRIGHT"));
+		if (found && depth > 0 && entry.depth >= remainingDepth) {
+			// Entries are stored from the side to move's point of view, so flip them at min nodes
+			double value = maxNode ? entry.score : -entry.score;
+			int bound = entry.bound;
+			if (!maxNode && bound != TranspositionTable::EXACT) {
+				bound = bound == TranspositionTable::LOWER ? TranspositionTable::UPPER : TranspositionTable::LOWER;
+			}
+			if (bound == TranspositionTable::EXACT
+				|| (bound == TranspositionTable::LOWER && value >= max)
+				|| (bound == TranspositionTable::UPPER && value <= min)) {
+				// Count the stored subtree as searched so iterative deepening doesn't think the tree ran out
+				context->depthTracker = std::max(context->depthTracker, std::min(maxDepth, depth + entry.depth));
+				return MoveVal(value, Location());
 			}
 		}
 	}
 
-	if (l.row < 7) {
-		if (state.board[l.row + 1][l.column] == id) {
-			adjacent.push_back(Location(l.row + 1, l.column, "DOWN"));
-		}
-
-		if (l.column > 0) {
-			if (state.board[l.row + 1][l.column - 1] == id) {
-				adjacent.push_back(Location(l.row + 1, l.column - 1, "DOWNLEFT"));
+	// Multi-ProbCut: when a shallow search puts the node far enough outside the window, the full depth search
+	// is taken to fail the same way and skipped (see ProbCut). The root is always searched in full
+	if (depth > 0 && !timedOut && context->probCut && ProbCut::Loaded()) {
+		const ProbCut::Check * checks;
+		int count = ProbCut::Checks(64 - Bitboard::Count(state.own | state.opp), remainingDepth, &checks);
+		for (int c = 0; c < count; ++c) {
+			if (max < INT_MAX) {
+				double bound = ProbCut::HighBound(checks[c], max, maxNode);
+				MoveVal shallow = MinimaxSearch(state, bound - 1, bound, depth, depth + checks[c].depth, context, features);
+				if (shallow.value >= bound && !context->TimedOut()) {
+					++context->probCuts;
+					return MoveVal(max, Location());
+				}
 			}
-		}
-		if (l.column < 7) {
-			if (state.board[l.row + 1][l.column + 1] == id) {
-				adjacent.push_back(Location(l.row + 1, l.column + 1, "DOWNRIGHT"));
+			if (min > INT_MIN) {
+				double bound = ProbCut::LowBound(checks[c], min, maxNode);
+				MoveVal shallow = MinimaxSearch(state, bound, bound + 1, depth, depth + checks[c].depth, context, features);
+				if (shallow.value <= bound && !context->TimedOut()) {
+					++context->probCuts;
+					return MoveVal(min, Location());
+				}
 			}
 		}
 	}
 
-	if (l.column > 0) {
-		if (state.board[l.row][l.column - 1] == id) {
-			adjacent.push_back(Location(l.row, l.column - 1, "LEFT"));
-		}
-	}
-	if (l.column < 7) {
-		if (state.board[l.row][l.column + 1] == id) {
-			adjacent.push_back(Location(l.row, l.column + 1, "RIGHT"));
+	// We simply evaluate the heuristic of a node if we've timed out,
+	// if we have reached the maximum depth, or there are no children
+	if (timedOut || !remainingDepth) {
+		// Return heuristic value (from the current player's point of view) with empty location to be set by caller
+		++context->leafEvaluations;
+		double value = evaluate(state, features, maxNode);
+		return MoveVal(maxNode ? value : -value, Location());
+	}
+
+	// Generate the moves; the state is always seen from the side to move,
+	// so this is the current player at max nodes and the enemy at min nodes
+	MoveList moves(state);
+	if (!moves.count) {
+		++context->leafEvaluations;
+		double value = evaluate(state, features, maxNode);
+		return MoveVal(maxNode ? value : -value, Location());
+	}
+	++context->expandedNodes;
+
+	// Search the moves most likely to cause a cutoff first
+	int order[MoveList::MAX_MOVES];
+	context->orderer.Order(moves, hashMove, depth, order);
+
+	// Each move is made on the state in place and unmade once its subtree has been searched.
+	// Bounds are fail-soft: the best value found is returned even when it falls outside the window,
+	// which gives the transposition table and aspiration windows tighter bounds to work with
+	int bestSquare = TranspositionTable::NO_MOVE;
+	double bestVal = maxNode ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+	Pattern::Features childFeatures;
+
+	// With the heuristic, the children one ply from the end are all leaves, so they are scored a batch
+	// at a time rather than through a call each. A leaf's value doesn't depend on the window, so this
+	// finds the same values; it only costs scoring up to a batch's worth of children past a cutoff
+	bool frontier = remainingDepth == 1 && depth > 0 && !features;
+	GameState leaves[Heuristic::BATCH];
+	double leafScores[Heuristic::BATCH];
+	for (int n = 0; n < moves.count; ++n) {
+		int i = order[n];
+		int square = moves.squares[i];
+		if (features) {
+			Pattern::Play(*features, square, moves.changed[i], maxNode, &childFeatures);
 		}
-	}
-
-	return adjacent;
-}
 
-MoveVal Game::MinimaxSearch(GameState state, double min, double max, int depth, int maxDepth, int currentId, int enemyId, clock_t upperTimeLimit, int * depthTracker) {
-	// Conditionally increment depthTracker
-	if (depth > *depthTracker) {
-		++(*depthTracker);
-	}
-
-	// Check if timed out
-	bool timedOut = false;
-	if (std::clock() > upperTimeLimit) {
-		timedOut = true;
-	}
-
-	// Determine whether the current state is a max node or a min node based on depth
-	bool maxNode = (depth) % 2 == 0; // Since we are starting at max states, even depth means we are at a max node
-
-	// Compile vector of children
-	vector<Location> legalMoves;
-	vector<GameState> children;
-	if (maxNode) {
-		children = getChildren(state, currentId, enemyId, &legalMoves); // Get children from current player's point of view if max state
-	} else {
-		children = getChildren(state, enemyId, currentId, &legalMoves); // Get children from enemy's point of view if min state
-	}
+		// The window narrowed by the moves searched so far
+		double alpha = maxNode ? std::max(min, bestVal) : min;
+		double beta = maxNode ? max : std::min(max, bestVal);
 
-	// We simply evaluate the heuristic of a node if we've timed out,
-	// if we have reached the maximum depth, or there are no children
-	if (timedOut || !(maxDepth - depth) || !children.size()) {
-		// Return heuristic value with empty location to be set by caller
-		return MoveVal(heuristic(state, currentId, enemyId), Location());
-	}
+		MoveVal move;
+		if (frontier) {
+			if (n % Heuristic::BATCH == 0) {
+				int batch = std::min(Heuristic::BATCH, moves.count - n);
+				for (int b = 0; b < batch; ++b) {
+					leaves[b] = GameState::ApplyMove(state, moves.changed[order[n + b]]);
+				}
+				Heuristic::EvaluateBatch(leaves, batch, leafScores);
+			}
 
-	if (maxNode) {
-		double bestVal = min;
-		Location bestMove;
-		for (unsigned int i = 0; i < children.size(); ++i) {
-			MoveVal move = MinimaxSearch(children[i], bestVal, max, depth + 1, maxDepth, currentId, enemyId, upperTimeLimit, depthTracker);
-			move.move = legalMoves[i]; // Set this so we get a meaningful move (in case of a leaf)
-			if (move.value > bestVal) {
-				bestVal = move.value;
-				bestMove = move.move;
+			// What the child's own call would have done
+			if (depth + 1 > context->depthTracker) {
+				++context->depthTracker;
 			}
-			if (bestVal > max) {
-				return MoveVal(max, bestMove);
+			context->CountNode();
+			++context->leafEvaluations;
+			double value = std::floor(leafScores[n % Heuristic::BATCH] + 0.5);
+			move.value = maxNode ? -value : value;
+		} else {
+			// Principal variation search: the first move is expected to be the best, so the rest are only searched
+			// with a null window to prove they are no better, and searched again properly when that fails.
+			// Scores are whole numbers, so a window one point wide has no values inside it
+			state.Make(moves.changed[i]);
+			if (n == 0) {
+				move = MinimaxSearch(state, alpha, beta, depth + 1, maxDepth, context, features ? &childFeatures : NULL);
+			} else if (maxNode) {
+				move = MinimaxSearch(state, alpha, alpha + 1, depth + 1, maxDepth, context, features ? &childFeatures : NULL);
+				if (move.value > alpha && move.value < beta && !context->TimedOut()) {
+					move = MinimaxSearch(state, alpha, beta, depth + 1, maxDepth, context, features ? &childFeatures : NULL);
+				}
+			} else {
+				move = MinimaxSearch(state, beta - 1, beta, depth + 1, maxDepth, context, features ? &childFeatures : NULL);
+				if (move.value < beta && move.value > alpha && !context->TimedOut()) {
+					move = MinimaxSearch(state, alpha, beta, depth + 1, maxDepth, context, features ? &childFeatures : NULL);
+				}
 			}
+			state.Unmake(moves.changed[i], square);
 		}
-		return MoveVal(bestVal, bestMove);
-	} else {
-		double bestVal = max;
-		Location bestMove;
-		for (unsigned int i = 0; i < children.size(); ++i) {
-			MoveVal move = MinimaxSearch(children[i], min, bestVal, depth + 1, maxDepth, currentId, enemyId, upperTimeLimit, depthTracker);
-			move.move = legalMoves[i]; // Set this so we get a meaningful move (in case of a leaf)
-			if (move.value < bestVal) {
-				bestVal = move.value;
-				bestMove = move.move;
-			}
-			if (bestVal < min) {
-				return MoveVal(min, bestMove);
+
+		if (depth == 0) {
+			// The value of an unfinished search can't be trusted, so the root keeps what it has finished
+			if (context->TimedOut()) {
+				break;
 			}
+			context->completedRootMoves |= 1ULL << square;
+		}
+		if (maxNode ? move.value > bestVal : move.value < bestVal) {
+			bestVal = move.value;
+			bestSquare = square;
+		}
+		if (maxNode ? bestVal >= max : bestVal <= min) {
+			context->orderer.RecordCutoff(bestSquare, depth, remainingDepth, n);
+			break;
 		}
-		return MoveVal(bestVal, bestMove);
-	}
-}
 
-double Game::heuristic(GameState state, int currentId, int enemyId) {
-	// Heuristic is heavily based off of function from
-	// https://kartikkukreja.wordpress.com/2013/03/30/heuristic-function-for-reversiothello/
-	// and slightly modified to fit the purposes of this project
-
-	int myTiles = 0, enemyTiles = 0, i, j, k, myFrontTiles = 0, enemyFrontTiles = 0, x, y;
-	double percentage = 0, corner = 0, closeness = 0, mobility = 0, frontier = 0, difference = 0;
-
-	int X1 [] = { -1, -1, 0, 1, 1, 1, 0, -1 };
-	int Y1 [] = { 0, 1, 1, 1, 0, -1, -1, -1 };
-	int V[8][8] = {
-		{ 20, -3, 11, 8, 8, 11, -3, 20 },
-		{ -3, -7, -4, 1, 1, -4, -7, -3 },
-		{ 11, -4, 2, 2, 2, 2, -4, 11 },
-		{ 8, 1, 2, -3, -3, 2, 1, 8 },
-		{ 8, 1, 2, -3, -3, 2, 1, 8 },
-		{ 11, -4, 2, 2, 2, 2, -4, 11 },
-		{ -3, -7, -4, 1, 1, -4, -7, -3 },
-		{ 20, -3, 11, 8, 8, 11, -3, 20 }
-	};
-
-	// Piece difference, frontier disks and disk squares
-	for (i = 0; i < 8; i++) {
-		for (j = 0; j < 8; j++)  {
-			if (state.board[i][j] == currentId)  {
-				difference += V[i][j];
-				myTiles++;
-			} else if (state.board[i][j] == enemyId)  {
-				difference -= V[i][j];
-				enemyTiles++;
-			}
-			if (state.board[i][j] != 0)   {
-				for (k = 0; k < 8; k++)  {
-					x = i + X1[k]; y = j + Y1[k];
-					if (x >= 0 && x < 8 && y >= 0 && y < 8 && state.board[x][y] == 0) {
-						if (state.board[i][j] == currentId)  myFrontTiles++;
-						else enemyFrontTiles++;
-						break;
-					}
+		// Young Brothers Wait: once the eldest brother has been searched without a cutoff,
+		// the younger ones can be handed out to other threads
+		if (n == 0 && context->pool && context->pool->ShouldSplit(remainingDepth, moves.count)) {
+			int index = -1;
+			context->pool->Split(context, state, features, moves, order, 1, maxNode, depth, maxDepth, min, max, &bestVal, &index);
+			if (index >= 0) {
+				bestSquare = moves.squares[index];
+				if (depth == 0) {
+					context->completedRootMoves |= 1ULL << bestSquare;
 				}
 			}
+			break;
 		}
 	}
 
-	if (myTiles > enemyTiles) {
-		percentage = (myTiles / (myTiles + enemyTiles)) * 100;
-	} else if (myTiles < enemyTiles) {
-		percentage = -(enemyTiles / (myTiles + enemyTiles)) * 100;
-	} else {
-		percentage = 0;
+	MoveVal result(bestVal, Location());
+	if (bestSquare != TranspositionTable::NO_MOVE) {
+		result.move = Location::FromSquare(bestSquare);
 	}
 
-	if (myFrontTiles > enemyFrontTiles) {
-		frontier = -(100.0 * myFrontTiles) / (myFrontTiles + enemyFrontTiles);
-	} else if (myFrontTiles < enemyFrontTiles) {
-		frontier = (100.0 * enemyFrontTiles) / (myFrontTiles + enemyFrontTiles);
-	} else {
-		frontier = 0;
+	// Bounds are from the max player's point of view
+	TranspositionTable::Bound bound = TranspositionTable::EXACT;
+	if (bestVal <= min) {
+		bound = TranspositionTable::UPPER;
+	} else if (bestVal >= max) {
+		bound = TranspositionTable::LOWER;
 	}
 
-	// Corner occupancy
-	myTiles = enemyTiles = 0;
-	if (state.board[0][0] == currentId) myTiles++;
-	else if (state.board[0][0] == enemyId) enemyTiles++;
-	if (state.board[0][7] == currentId) myTiles++;
-	else if (state.board[0][7] == enemyId) enemyTiles++;
-	if (state.board[7][0] == currentId) myTiles++;
-	else if (state.board[7][0] == enemyId) enemyTiles++;
-	if (state.board[7][7] == currentId) myTiles++;
-	else if (state.board[7][7] == enemyId) enemyTiles++;
-	corner = 25 * (myTiles - enemyTiles);
-
-	// Corner closeness
-	myTiles = enemyTiles = 0;
-	if (state.board[0][0] == 0)   {
-		if (state.board[0][1] == currentId) myTiles++;
-		else if (state.board[0][1] == enemyId) enemyTiles++;
-		if (state.board[1][1] == currentId) myTiles++;
-		else if (state.board[1][1] == enemyId) enemyTiles++;
-		if (state.board[1][0] == currentId) myTiles++;
-		else if (state.board[1][0] == enemyId) enemyTiles++;
+	// A move that failed low is no better than any other, so it isn't worth trying first next time
+	bool failedLow = maxNode ? bound == TranspositionTable::UPPER : bound == TranspositionTable::LOWER;
+	if (failedLow) {
+		bestSquare = TranspositionTable::NO_MOVE;
 	}
-	if (state.board[0][7] == 0)   {
-		if (state.board[0][6] == currentId) myTiles++;
-		else if (state.board[0][6] == enemyId) enemyTiles++;
-		if (state.board[1][6] == currentId) myTiles++;
-		else if (state.board[1][6] == enemyId) enemyTiles++;
-		if (state.board[1][7] == currentId) myTiles++;
-		else if (state.board[1][7] == enemyId) enemyTiles++;
-	}
-	if (state.board[7][0] == 0)   {
-		if (state.board[7][1] == currentId) myTiles++;
-		else if (state.board[7][1] == enemyId) enemyTiles++;
-		if (state.board[6][1] == currentId) myTiles++;
-		else if (state.board[6][1] == enemyId) enemyTiles++;
-		if (state.board[6][0] == currentId) myTiles++;
-		else if (state.board[6][0] == enemyId) enemyTiles++;
-	}
-	if (state.board[7][7] == 0)   {
-		if (state.board[6][7] == currentId) myTiles++;
-		else if (state.board[6][7] == enemyId) enemyTiles++;
-		if (state.board[6][6] == currentId) myTiles++;
-		else if (state.board[6][6] == enemyId) enemyTiles++;
-		if (state.board[7][6] == currentId) myTiles++;
-		else if (state.board[7][6] == enemyId) enemyTiles++;
-	}
-	closeness = -12.5 * (myTiles - enemyTiles);
-
-	// Mobility
-	myTiles = LegalMoves(state, currentId).size();
-	enemyTiles = LegalMoves(state, enemyId).size();
-	if (myTiles > enemyTiles) {
-		mobility = (100.0 * myTiles) / (myTiles + enemyTiles);
-	} else if (myTiles < enemyTiles) {
-		mobility = -(100.0 * enemyTiles) / (myTiles + enemyTiles);
-	} else {
-		mobility = 0;
+
+	// Store the result unless the search timed out underneath us, since then the value is incomplete
+	if (useTable && !context->TimedOut()) {
+		// Flip to the side to move's (the enemy's) point of view at min nodes
+		double value = result.value;
+		if (!maxNode) {
+			value = -value;
+			if (bound != TranspositionTable::EXACT) {
+				bound = bound == TranspositionTable::LOWER ? TranspositionTable::UPPER : TranspositionTable::LOWER;
+			}
+		}
+		transpositionTable.Store(key, remainingDepth, bound, value, TranspositionTable::MoveToKey(bestSquare, symmetry));
+		if (remainingDepth >= PositionCache::MIN_DEPTH) {
+			positionCache.Store(state, cacheKind, remainingDepth, bound, value, bestSquare);
+		}
 	}
 
-	// Final weighted score
-	double score = (10 * percentage) + (750 * corner) + (375 * closeness) + (80 * mobility) + (75 * frontier) + (10 * difference);
-	return score;
+	return result;
 }
 
-vector<GameState> Game::getChildren(GameState state, int currentId, int enemyId, vector<Location> * legalMoves) {
-	// Get all legal moves
-	std::vector<Location> legal = Game::LegalMoves(state, currentId);
-	if (legalMoves) {
-		*legalMoves = legal;
+double Game::evaluate(GameState state, const Pattern::Features * features, bool maxNode) {
+	if (features) {
+		return Pattern::Evaluate(*features, 64 - Bitboard::Count(state.own | state.opp), maxNode);
 	}
 
-	// Get resulting states from legal moves
-	std::vector<GameState> newStates;
-	for (unsigned int i = 0; i < legal.size(); ++i) {
-		newStates.push_back(GameState::ApplyMove(state, Game::GetChangedPieces(state, legal[i], currentId, enemyId), currentId));
-	}
-	return newStates;
+	// Rounded to whole points, which the transposition table's float scores hold exactly
+	// and which lets principal variation search use a window one point wide
+	return std::floor(heuristic(state) + 0.5);
+}
+
+double Game::heuristic(GameState state) {
+	return Heuristic::Evaluate(state);
 }
@@ -3,12 +3,20 @@
 
 #include "Utils.h"
 #include "Player.h"
+#include "TranspositionTable.h"
+#include "SearchContext.h"
+#include "Pattern.h"
+#include "OpeningBook.h"
+#include "GameArchive.h"
+#include "PositionCache.h"
 
 #include <string>
-#include <ctime>
 
 class Game {
 
+	// The microbenchmarks time the private search helpers too
+	friend class Benchmark;
+
 	// The players in the game
 	Player * player1;
 	Player * player2;
@@ -19,27 +27,41 @@ class Game {
 	// The current state of the game
 	GameState currentState;
 
-	// All previous states of the board
+	// All previous states of the board, each seen from the player who moved in it
 	std::vector<GameState> history;
 
+	// The game so far, for the archive
+	GameArchive::Record record;
+
 	// Keeps track of states where the previous turn was skipped due to a lack of turns
 	bool lastSkipped;
 
-	// Finds all locations that are adjacent to provided location with given id (defaults to 0/empty)
-	static std::vector<Location> getAdjacentLocations(GameState, Location, int id = 0);
+	// Heuristic function that returns a value for a specific state from the point of view of the player to move
+	static double heuristic(GameState);
 
-	// Heuristic function that returns a value for a specific state and player id
-	static double heuristic(GameState, int, int);
+	// Uses the pattern tables if the features are being tracked (weights have been loaded), or the heuristic otherwise
+	static double evaluate(GameState, const Pattern::Features *, bool maxNode);
 
-	// Returns all children of a certain state given player ids;
-	// If legalMoves pointer is supplied, then it gets set to a vector of legal moves
-	static std::vector<GameState> getChildren(GameState, int, int, std::vector<Location> * legalMoves = NULL);
+	// Returns the discs of the given player in the current state
+	uint64_t discsOf(Player *);
 
 public:
 
 	// The time limit, in seconds, that a computer player has to make a move
 	static int timeLimit;
 
+	// Shared by every search so that work carries over between iterations and between moves
+	static TranspositionTable transpositionTable;
+
+	// Consulted before searching; stays closed unless a book file is given
+	static OpeningBook openingBook;
+
+	// Every finished game is added to it, if it has been opened
+	static GameArchive archive;
+
+	// Deep search and endgame results kept on disk between runs; stays closed unless a cache file is given
+	static PositionCache positionCache;
+
 	// Flag for game over
 	bool isOver;
 
@@ -47,7 +69,7 @@ public:
 	// Automatically assigns player1 to currentPlayer
 	Game(Player *, Player *, int);
 
-	// Initializes a game with two players, a time limit, a current state, and current player id;
+	// Initializes a game with two players, a time limit, a current state (seen from the player to move), and current player id;
 	Game(Player *, Player *, int, GameState, int);
 
 	// Getters
@@ -63,18 +85,25 @@ public:
 	// Prints results of the game (who won, score, etc)
 	void PrintResults();
 
-	// Returns an array of legal moves given a current state and id of player making the move
-	static std::vector<Location> LegalMoves(GameState, int);
+	// Returns an array of legal moves for the player to move in the given state
+	static std::vector<Location> LegalMoves(GameState);
 
 	// Returns Game object loaded from file with flags to indicate player types
 	static Game FromFile(std::string, bool, bool);
 
 	// Searches the game tree for the best move
-	// and selects a move after provided time limit or entire tree searched
-	static MoveVal MinimaxSearch(GameState, double, double, int, int, int, int, clock_t, int * depthTracker);
-
-	// Finds all locations that would be changed by a given move from a state
-	static std::vector<Location> GetChangedPieces(GameState, Location, int, int);
+	// and selects a move after provided time limit or entire tree searched;
+	// the context carries the deadline and this thread's move ordering data, and must be shared by a whole iterative deepening run.
+	// The features are the state's pattern numbers, if the parent already has them; they are worked out from scratch otherwise
+	static MoveVal MinimaxSearch(GameState, double, double, int, int, SearchContext *, const Pattern::Features * = NULL);
+
+	// The line of play the search expects after the given move, read from the best moves in the transposition table;
+	// squares, starting with the move itself, and at most length of them. pruned says whether the search used
+	// Multi-ProbCut, whose entries are keyed apart (see TranspositionTable::Key)
+	static std::vector<int> PrincipalVariation(GameState, Location, int, bool pruned);
+
+	// Finds all locations that would be changed by a given move from a state (including the move itself)
+	static uint64_t GetChangedPieces(GameState, Location);
 
 };
 
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "GameArchive.h"
+
+const char GameArchive::MAGIC[8] = { 'O', 'T', 'H', 'G', 'A', 'M', 'E', '1' };
+
+// Writes all of the buffer, as a write to a file can stop short
+static bool writeAll(int fd, const unsigned char * data, size_t size) {
+	while (size) {
+		ssize_t written = write(fd, data, size);
+		if (written <= 0) {
+			return false;
+		}
+		data += written;
+		size -= written;
+	}
+	return true;
+}
+
+void GameArchive::Record::AddMove(int square, const SearchStats * searchStats) {
+	moves.push_back(square);
+
+	MoveStats entry;
+	memset(&entry, 0, sizeof(entry));
+	if (searchStats) {
+		entry.score = (int32_t) std::floor(searchStats->score + 0.5);
+		entry.nodes = (uint32_t) std::min<long long>(searchStats->nodes, UINT32_MAX);
+		entry.milliseconds = (uint32_t) (searchStats->seconds * 1000);
+		entry.depth = searchStats->depth;
+		entry.source = searchStats->source + 1;
+	}
+	stats.push_back(entry);
+}
+
+GameArchive::GameArchive() {
+	fd = -1;
+}
+
+GameArchive::~GameArchive() {
+	Close();
+}
+
+bool GameArchive::Open(const std::string & fileName) {
+	Close();
+
+	int file = open(fileName.c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+	if (file < 0) {
+		return false;
+	}
+
+	// Another process may be creating the archive too, so only whoever finds it empty under the lock writes the magic
+	flock(file, LOCK_EX);
+	struct stat info;
+	char magic[sizeof(MAGIC)];
+	bool valid = fstat(file, &info) == 0 && (info.st_size == 0
+		? writeAll(file, (const unsigned char *) MAGIC, sizeof(MAGIC))
+		: pread(file, magic, sizeof(magic), 0) == (ssize_t) sizeof(magic) && !memcmp(magic, MAGIC, sizeof(MAGIC)));
+	flock(file, LOCK_UN);
+
+	if (!valid) {
+		close(file);
+		return false;
+	}
+	fd = file;
+	return true;
+}
+
+void GameArchive::Close() {
+	if (fd >= 0) {
+		close(fd);
+	}
+	fd = -1;
+}
+
+size_t GameArchive::RecordSize(int moveCount) {
+	return sizeof(RecordHeader) + (moveCount + 7) / 8 * 8 + moveCount * sizeof(MoveStats);
+}
+
+bool GameArchive::Append(const Record & record) {
+	if (fd < 0) {
+		return false;
+	}
+
+	int moveCount = record.moves.size();
+	std::vector<unsigned char> data(RecordSize(moveCount), 0);
+	RecordHeader header;
+	memset(&header, 0, sizeof(header));
+	header.size = data.size();
+	header.moveCount = moveCount;
+	header.firstPlayer = record.firstPlayer;
+	header.result = record.result;
+	header.own = record.start.own;
+	header.opp = record.start.opp;
+	memcpy(&data[0], &header, sizeof(header));
+	if (moveCount) {
+		memcpy(&data[sizeof(header)], &record.moves[0], moveCount);
+		memcpy(&data[sizeof(header) + (moveCount + 7) / 8 * 8], &record.stats[0], moveCount * sizeof(MoveStats));
+	}
+
+	// One write under the lock, so that games from different writers never interleave
+	flock(fd, LOCK_EX);
+	bool written = writeAll(fd, &data[0], data.size());
+	flock(fd, LOCK_UN);
+	return written;
+}
+
+GameArchiveReader::GameArchiveReader() {
+	memory = NULL;
+	memorySize = 0;
+	offset = 0;
+}
+
+GameArchiveReader::~GameArchiveReader() {
+	Close();
+}
+
+bool GameArchiveReader::Open(const std::string & fileName) {
+	Close();
+
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) < 0 || (size_t) info.st_size < GameArchive::HEADER_SIZE) {
+		close(fd);
+		return false;
+	}
+	void * mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // The mapping keeps the file open
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+	if (memcmp(mapped, GameArchive::MAGIC, sizeof(GameArchive::MAGIC))) {
+		munmap(mapped, info.st_size);
+		return false;
+	}
+
+	// Games are read from start to end, so read well ahead
+	madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+
+	memory = mapped;
+	memorySize = info.st_size;
+	offset = GameArchive::HEADER_SIZE;
+	return true;
+}
+
+void GameArchiveReader::Close() {
+	if (memory) {
+		munmap(memory, memorySize);
+	}
+	memory = NULL;
+	memorySize = 0;
+	offset = 0;
+}
+
+bool GameArchiveReader::Next(Entry * entry) {
+	if (!memory || offset + sizeof(GameArchive::RecordHeader) > memorySize) {
+		return false;
+	}
+	const unsigned char * record = (const unsigned char *) memory + offset;
+	const GameArchive::RecordHeader * header = (const GameArchive::RecordHeader *) record;
+	if (header->size != GameArchive::RecordSize(header->moveCount) || offset + header->size > memorySize) {
+		return false;
+	}
+
+	entry->header = header;
+	entry->moves = record + sizeof(GameArchive::RecordHeader);
+	entry->stats = (const GameArchive::MoveStats *) (entry->moves + (header->moveCount + 7) / 8 * 8);
+	offset += header->size;
+	return true;
+}
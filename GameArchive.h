@@ -0,0 +1,133 @@
+#ifndef GAMEARCHIVE_H
+#define GAMEARCHIVE_H
+
+#include "Utils.h"
+#include "SearchStats.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Finished games kept in an append-only binary file, so that book building and evaluation tuning can go
+// through millions of them without parsing text. Games are only ever added to the end of the file, by
+// one write each under an exclusive lock, so any number of threads and processes can add to the same archive.
+//
+// File layout (little-endian, as the records are used in place):
+//   8 bytes   "OTHGAME1"
+//   records   one per game, each a multiple of 8 bytes long:
+//     RecordHeader
+//     moveCount squares (bytes), padded with zeros to a multiple of 8
+//     moveCount MoveStats
+// Passes aren't written, as they are forced: a player with no move hands the turn over before the next move
+class GameArchive {
+
+public:
+
+	struct RecordHeader {
+		uint32_t size; // Of the whole record
+		uint8_t moveCount;
+		uint8_t firstPlayer; // Id of the player to move at the start
+		int8_t result; // The first player's final disc difference, with empty squares going to the winner
+		uint8_t reserved;
+		uint64_t own; // Start position, seen from the first player
+		uint64_t opp;
+	};
+
+	// How a move was chosen (see SearchStats)
+	enum Source { NONE, SEARCH, BOOK, ENDGAME };
+
+	struct MoveStats {
+		int32_t score; // Rounded
+		uint32_t nodes; // Saturates rather than wrapping
+		uint32_t milliseconds;
+		uint8_t depth;
+		uint8_t source; // A Source; NONE for a player that doesn't search
+		uint8_t reserved[2];
+	};
+
+	// A game as it is being played, to be appended once it's over
+	struct Record {
+		GameState start;
+		int firstPlayer;
+		std::vector<uint8_t> moves;
+		std::vector<MoveStats> stats;
+		int result;
+
+		Record() : firstPlayer(1), result(0) { }
+
+		void AddMove(int square, const SearchStats *);
+	};
+
+	GameArchive();
+	~GameArchive();
+
+	// Opens the file for appending, creating it if there isn't one; returns false (with the archive closed)
+	// if it can't be opened or isn't an archive
+	bool Open(const std::string &);
+
+	void Close();
+
+	bool IsOpen() { return fd >= 0; }
+
+	// Adds the game to the end of the file; can be called from several threads at once
+	bool Append(const Record &);
+
+	static size_t RecordSize(int moveCount);
+
+private:
+
+	static const char MAGIC[8];
+	static const size_t HEADER_SIZE = 8;
+
+	int fd;
+
+	GameArchive(const GameArchive &);
+	GameArchive & operator=(const GameArchive &);
+
+	friend class GameArchiveReader;
+
+};
+
+// Goes through the games in an archive. The file is memory mapped and each game is read in place,
+// so reading costs little more than the disk. Games added after the archive was opened aren't seen,
+// and a record cut short (by a crash while it was being written) ends the archive
+class GameArchiveReader {
+
+public:
+
+	// A game in the mapped file, valid until the reader is closed
+	struct Entry {
+		const GameArchive::RecordHeader * header;
+		const uint8_t * moves;
+		const GameArchive::MoveStats * stats;
+
+		GameState Start() const { return GameState(header->own, header->opp); }
+	};
+
+	GameArchiveReader();
+	~GameArchiveReader();
+
+	// Maps the archive; returns false (with the reader closed) if it can't be mapped or isn't an archive
+	bool Open(const std::string &);
+
+	void Close();
+
+	// Reads the next game; returns false once there are no more
+	bool Next(Entry *);
+
+	// Goes back to the first game
+	void Rewind() { offset = GameArchive::HEADER_SIZE; }
+
+private:
+
+	void * memory;
+	size_t memorySize;
+	size_t offset;
+
+	GameArchiveReader(const GameArchiveReader &);
+	GameArchiveReader & operator=(const GameArchiveReader &);
+
+};
+
+#endif
@@ -0,0 +1,252 @@
+#include <immintrin.h>
+
+#include "Heuristic.h"
+#include "Bitboard.h"
+
+// Heuristic is heavily based off of function from
+// https://kartikkukreja.wordpress.com/2013/03/30/heuristic-function-for-reversiothello/
+// and slightly modified to fit the purposes of this project
+
+const int Heuristic::V[64] = {
+	20, -3, 11, 8, 8, 11, -3, 20,
+	-3, -7, -4, 1, 1, -4, -7, -3,
+	11, -4, 2, 2, 2, 2, -4, 11,
+	8, 1, 2, -3, -3, 2, 1, 8,
+	8, 1, 2, -3, -3, 2, 1, 8,
+	11, -4, 2, 2, 2, 2, -4, 11,
+	-3, -7, -4, 1, 1, -4, -7, -3,
+	20, -3, 11, 8, 8, 11, -3, 20
+};
+
+// Squares next to each corner, used for corner closeness
+static const uint64_t cornerAdjacent[4] = {
+	0x0000000000000302ULL, 0x000000000000c040ULL, 0x0203000000000000ULL, 0x40c0000000000000ULL
+};
+static const uint64_t cornerSquares[4] = {
+	0x0000000000000001ULL, 0x0000000000000080ULL, 0x0100000000000000ULL, 0x8000000000000000ULL
+};
+
+int Heuristic::weightCount = 0;
+int Heuristic::weights[MAX_WEIGHTS];
+uint64_t Heuristic::weightMasks[MAX_WEIGHTS];
+bool Heuristic::avx2 = false;
+bool Heuristic::initialized = Heuristic::init();
+
+bool Heuristic::init() {
+	for (int square = 0; square < 64; ++square) {
+		int w = 0;
+		while (w < weightCount && weights[w] != V[square]) {
+			++w;
+		}
+		if (w == weightCount) {
+			weights[weightCount] = V[square];
+			weightMasks[weightCount] = 0;
+			++weightCount;
+		}
+		weightMasks[w] |= 1ULL << square;
+	}
+
+	__builtin_cpu_init();
+	avx2 = __builtin_cpu_supports("avx2");
+	return true;
+}
+
+double Heuristic::combine(const Counts & counts) {
+	double percentage = 0, corner = 0, closeness = 0, mobility = 0, frontier = 0, difference = counts.squares;
+
+	// Whole number division, so this only counts when one side has been wiped out
+	if (counts.own > counts.opp) {
+		percentage = (counts.own / (counts.own + counts.opp)) * 100;
+	} else if (counts.own < counts.opp) {
+		percentage = -(counts.opp / (counts.own + counts.opp)) * 100;
+	}
+
+	if (counts.ownFrontier > counts.oppFrontier) {
+		frontier = -(100.0 * counts.ownFrontier) / (counts.ownFrontier + counts.oppFrontier);
+	} else if (counts.ownFrontier < counts.oppFrontier) {
+		frontier = (100.0 * counts.oppFrontier) / (counts.ownFrontier + counts.oppFrontier);
+	}
+
+	corner = 25 * (counts.ownCorners - counts.oppCorners);
+	closeness = -12.5 * (counts.ownCloseness - counts.oppCloseness);
+
+	if (counts.ownMobility > counts.oppMobility) {
+		mobility = (100.0 * counts.ownMobility) / (counts.ownMobility + counts.oppMobility);
+	} else if (counts.ownMobility < counts.oppMobility) {
+		mobility = -(100.0 * counts.oppMobility) / (counts.ownMobility + counts.oppMobility);
+	}
+
+	// Final weighted score
+	return (10 * percentage) + (750 * corner) + (375 * closeness) + (80 * mobility) + (75 * frontier) + (10 * difference);
+}
+
+void Heuristic::count(GameState state, Counts * counts) {
+	uint64_t own = state.own, opp = state.opp;
+	uint64_t empty = ~(own | opp);
+
+	// Piece difference, frontier disks and disk squares
+	counts->own = Bitboard::Count(own);
+	counts->opp = Bitboard::Count(opp);
+	counts->squares = 0;
+	for (uint64_t b = own; b; b &= b - 1) {
+		counts->squares += V[Bitboard::FirstSquare(b)];
+	}
+	for (uint64_t b = opp; b; b &= b - 1) {
+		counts->squares -= V[Bitboard::FirstSquare(b)];
+	}
+	uint64_t nextToEmpty = Bitboard::Neighbors(empty);
+	counts->ownFrontier = Bitboard::Count(own & nextToEmpty);
+	counts->oppFrontier = Bitboard::Count(opp & nextToEmpty);
+
+	// Corner occupancy and closeness
+	counts->ownCorners = Bitboard::Count(own & Bitboard::CORNERS);
+	counts->oppCorners = Bitboard::Count(opp & Bitboard::CORNERS);
+	uint64_t closeSquares = 0;
+	for (int i = 0; i < 4; ++i) {
+		if (empty & cornerSquares[i]) {
+			closeSquares |= cornerAdjacent[i];
+		}
+	}
+	counts->ownCloseness = Bitboard::Count(own & closeSquares);
+	counts->oppCloseness = Bitboard::Count(opp & closeSquares);
+
+	// Mobility
+	counts->ownMobility = Bitboard::Count(Bitboard::Moves(own, opp));
+	counts->oppMobility = Bitboard::Count(Bitboard::Moves(opp, own));
+}
+
+double Heuristic::Evaluate(GameState state) {
+	Counts counts;
+	count(state, &counts);
+	return combine(counts);
+}
+
+// The AVX2 versions of the Bitboard functions, for four boards at once (one per 64 bit lane).
+// They are compiled for AVX2 whatever the build flags, and only called once the CPU is known to have it
+#define AVX2 __attribute__((target("avx2")))
+
+static const uint64_t NOT_COLUMN_0 = 0xfefefefefefefefeULL;
+static const uint64_t NOT_COLUMN_7 = 0x7f7f7f7f7f7f7f7fULL;
+
+template <int S> AVX2 static inline __m256i shift(__m256i b) {
+	return S > 0 ? _mm256_slli_epi64(b, S > 0 ? S : 0) : _mm256_srli_epi64(b, S < 0 ? -S : 0);
+}
+
+// Population count of each lane: bytes are counted a nibble at a time by table lookup, then summed per lane
+AVX2 static inline __m256i count4(__m256i b) {
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	__m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(b, nibble));
+	__m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(b, 4), nibble));
+	return _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256());
+}
+
+// Kogge-Stone fill and moves along one direction, as in Bitboard
+template <int S> AVX2 static inline __m256i movesInDirection4(__m256i own, __m256i opp, __m256i empty, uint64_t mask) {
+	__m256i m = _mm256_set1_epi64x(mask);
+	__m256i pro = _mm256_and_si256(opp, m);
+	__m256i gen = own;
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shift<S>(gen)));
+	pro = _mm256_and_si256(pro, shift<S>(pro));
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shift<2 * S>(gen)));
+	pro = _mm256_and_si256(pro, shift<2 * S>(pro));
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shift<4 * S>(gen)));
+	__m256i chain = _mm256_andnot_si256(own, gen);
+	return _mm256_and_si256(_mm256_and_si256(shift<S>(chain), m), empty);
+}
+
+AVX2 static inline __m256i moves4(__m256i own, __m256i opp) {
+	__m256i empty = _mm256_xor_si256(_mm256_or_si256(own, opp), _mm256_set1_epi64x(-1));
+	__m256i moves = _mm256_or_si256(movesInDirection4<1>(own, opp, empty, NOT_COLUMN_0), movesInDirection4<-1>(own, opp, empty, NOT_COLUMN_7));
+	moves = _mm256_or_si256(moves, _mm256_or_si256(movesInDirection4<8>(own, opp, empty, ~0ULL), movesInDirection4<-8>(own, opp, empty, ~0ULL)));
+	moves = _mm256_or_si256(moves, _mm256_or_si256(movesInDirection4<9>(own, opp, empty, NOT_COLUMN_0), movesInDirection4<7>(own, opp, empty, NOT_COLUMN_7)));
+	return _mm256_or_si256(moves, _mm256_or_si256(movesInDirection4<-7>(own, opp, empty, NOT_COLUMN_0), movesInDirection4<-9>(own, opp, empty, NOT_COLUMN_7)));
+}
+
+AVX2 static inline __m256i neighbors4(__m256i b) {
+	__m256i horizontal = _mm256_or_si256(_mm256_and_si256(shift<1>(b), _mm256_set1_epi64x(NOT_COLUMN_0)),
+		_mm256_and_si256(shift<-1>(b), _mm256_set1_epi64x(NOT_COLUMN_7)));
+	__m256i row = _mm256_or_si256(b, horizontal);
+	return _mm256_or_si256(horizontal, _mm256_or_si256(shift<8>(row), shift<-8>(row)));
+}
+
+AVX2 void Heuristic::countAvx2(const GameState * states, Counts * counts) {
+	__m256i own = _mm256_set_epi64x(states[3].own, states[2].own, states[1].own, states[0].own);
+	__m256i opp = _mm256_set_epi64x(states[3].opp, states[2].opp, states[1].opp, states[0].opp);
+	__m256i empty = _mm256_xor_si256(_mm256_or_si256(own, opp), _mm256_set1_epi64x(-1));
+
+	// Weighted squares: each distinct weight times how many more of its squares we have
+	__m256i squares = _mm256_setzero_si256();
+	for (int w = 0; w < weightCount; ++w) {
+		__m256i mask = _mm256_set1_epi64x(weightMasks[w]);
+		__m256i difference = _mm256_sub_epi64(count4(_mm256_and_si256(own, mask)), count4(_mm256_and_si256(opp, mask)));
+		squares = _mm256_add_epi64(squares, _mm256_mul_epi32(difference, _mm256_set1_epi64x(weights[w])));
+	}
+
+	__m256i nextToEmpty = neighbors4(empty);
+	__m256i corners = _mm256_set1_epi64x(Bitboard::CORNERS);
+
+	// The squares next to each corner, where the corner is empty
+	__m256i closeSquares = _mm256_setzero_si256();
+	for (int i = 0; i < 4; ++i) {
+		__m256i cornerEmpty = _mm256_xor_si256(_mm256_cmpeq_epi64(_mm256_and_si256(empty, _mm256_set1_epi64x(cornerSquares[i])), _mm256_setzero_si256()),
+			_mm256_set1_epi64x(-1));
+		closeSquares = _mm256_or_si256(closeSquares, _mm256_and_si256(cornerEmpty, _mm256_set1_epi64x(cornerAdjacent[i])));
+	}
+
+	alignas(32) int64_t lanes[11][4];
+	_mm256_store_si256((__m256i *) lanes[0], count4(own));
+	_mm256_store_si256((__m256i *) lanes[1], count4(opp));
+	_mm256_store_si256((__m256i *) lanes[2], count4(_mm256_and_si256(own, nextToEmpty)));
+	_mm256_store_si256((__m256i *) lanes[3], count4(_mm256_and_si256(opp, nextToEmpty)));
+	_mm256_store_si256((__m256i *) lanes[4], count4(_mm256_and_si256(own, corners)));
+	_mm256_store_si256((__m256i *) lanes[5], count4(_mm256_and_si256(opp, corners)));
+	_mm256_store_si256((__m256i *) lanes[6], count4(_mm256_and_si256(own, closeSquares)));
+	_mm256_store_si256((__m256i *) lanes[7], count4(_mm256_and_si256(opp, closeSquares)));
+	_mm256_store_si256((__m256i *) lanes[8], count4(moves4(own, opp)));
+	_mm256_store_si256((__m256i *) lanes[9], count4(moves4(opp, own)));
+	_mm256_store_si256((__m256i *) lanes[10], squares);
+
+	for (int i = 0; i < 4; ++i) {
+		counts[i].own = lanes[0][i];
+		counts[i].opp = lanes[1][i];
+		counts[i].ownFrontier = lanes[2][i];
+		counts[i].oppFrontier = lanes[3][i];
+		counts[i].ownCorners = lanes[4][i];
+		counts[i].oppCorners = lanes[5][i];
+		counts[i].ownCloseness = lanes[6][i];
+		counts[i].oppCloseness = lanes[7][i];
+		counts[i].ownMobility = lanes[8][i];
+		counts[i].oppMobility = lanes[9][i];
+		counts[i].squares = lanes[10][i];
+	}
+}
+
+void Heuristic::EvaluateBatch(const GameState * states, int count, double * scores) {
+	int i = 0;
+	if (avx2) {
+		Counts counts[BATCH];
+		for (; i + BATCH <= count; i += BATCH) {
+			countAvx2(states + i, counts);
+			for (int j = 0; j < BATCH; ++j) {
+				scores[i + j] = combine(counts[j]);
+			}
+		}
+
+		// Pad out a short batch rather than falling back to one at a time
+		if (i < count) {
+			GameState padded[BATCH];
+			for (int j = 0; j < BATCH; ++j) {
+				padded[j] = states[i + j < count ? i + j : i];
+			}
+			countAvx2(padded, counts);
+			for (int j = 0; i + j < count; ++j) {
+				scores[i + j] = combine(counts[j]);
+			}
+		}
+		return;
+	}
+	for (; i < count; ++i) {
+		scores[i] = Evaluate(states[i]);
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef HEURISTIC_H
+#define HEURISTIC_H
+
+#include "Utils.h"
+
+#include <cstdint>
+
+// The hand written evaluation the search uses when no pattern weights are loaded.
+// Most of its cost is counting bits (discs, frontier discs, moves, weighted squares), which for
+// several positions at once can be done side by side in SIMD registers, so it can also score a batch
+// of positions in one call. With AVX2 (checked at run time) four positions go through each pass;
+// otherwise they are scored one at a time. Either way the scores are exactly the same
+class Heuristic {
+
+public:
+
+	// Positions that the AVX2 path scores together; batches of any size are accepted
+	static const int BATCH = 4;
+
+	// Score of the state from the point of view of the player to move
+	static double Evaluate(GameState);
+
+	// Scores count states into scores, each as Evaluate would
+	static void EvaluateBatch(const GameState *, int count, double * scores);
+
+	// Whether EvaluateBatch uses AVX2 on this machine
+	static bool UsingAvx2() { return avx2; }
+
+private:
+
+	// What the score is worked out from, for one position
+	struct Counts {
+		int own, opp; // Discs
+		int ownFrontier, oppFrontier; // Discs next to an empty square
+		int ownCorners, oppCorners;
+		int ownCloseness, oppCloseness; // Discs next to an empty corner
+		int ownMobility, oppMobility;
+		int squares; // Sum of the square weights of our discs less the opponent's
+	};
+
+	static double combine(const Counts &);
+	static void count(GameState, Counts *);
+	static void countAvx2(const GameState *, Counts *);
+
+	// Square weights, and the same split into masks of the squares sharing each distinct weight
+	static const int V[64];
+	static const int MAX_WEIGHTS = 16;
+	static int weightCount;
+	static int weights[MAX_WEIGHTS];
+	static uint64_t weightMasks[MAX_WEIGHTS];
+
+	static bool avx2;
+	static bool initialized;
+	static bool init();
+
+};
+
+#endif
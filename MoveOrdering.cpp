@@ -0,0 +1,95 @@
+#include "MoveOrdering.h"
+#include "TranspositionTable.h"
+
+// Ordering tiers; history scores are kept below the static square tier so corners always come first
+static const int HASH_MOVE_SCORE = 1 << 30;
+static const int KILLER_SCORE = 1 << 29;
+static const int SQUARE_RANK_SCORE = 1 << 26;
+static const int HISTORY_LIMIT = 1 << 24;
+
+const int MoveOrderer::squareRank[64] = {
+	 2, -1,  0,  0,  0,  0, -1,  2,
+	-1, -2,  0,  0,  0,  0, -2, -1,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	-1, -2,  0,  0,  0,  0, -2, -1,
+	 2, -1,  0,  0,  0,  0, -1,  2
+};
+
+MoveOrderer::MoveOrderer() {
+	cutoffs = 0;
+	firstMoveCutoffs = 0;
+	for (int i = 0; i < 64; ++i) {
+		history[i] = 0;
+	}
+	NewSearch();
+}
+
+void MoveOrderer::NewSearch() {
+	for (int i = 0; i < MAX_PLY; ++i) {
+		killers[i][0] = killers[i][1] = TranspositionTable::NO_MOVE;
+	}
+
+	// Keep some of what was learned on the last move, but let the new position take over quickly
+	for (int i = 0; i < 64; ++i) {
+		history[i] /= 4;
+	}
+
+	cutoffs = 0;
+	firstMoveCutoffs = 0;
+}
+
+void MoveOrderer::Order(const MoveList & moves, int hashMove, int ply, int * order) {
+	int scores[MoveList::MAX_MOVES];
+	int count = moves.count;
+
+	for (int i = 0; i < count; ++i) {
+		int square = moves.squares[i];
+		if (square == hashMove) {
+			scores[i] = HASH_MOVE_SCORE;
+		} else if (square == killers[ply][0]) {
+			scores[i] = KILLER_SCORE;
+		} else if (square == killers[ply][1]) {
+			scores[i] = KILLER_SCORE - 1;
+		} else {
+			scores[i] = squareRank[square] * SQUARE_RANK_SCORE + history[square];
+		}
+		order[i] = i;
+	}
+
+	// Insertion sort, since there are rarely more than a dozen or so moves
+	for (int i = 1; i < count; ++i) {
+		int index = order[i];
+		int j = i - 1;
+		while (j >= 0 && scores[order[j]] < scores[index]) {
+			order[j + 1] = order[j];
+			--j;
+		}
+		order[j + 1] = index;
+	}
+}
+
+void MoveOrderer::RecordCutoff(int square, int ply, int remainingDepth, int moveNumber) {
+	++cutoffs;
+	if (moveNumber == 0) {
+		++firstMoveCutoffs;
+	}
+
+	if (ply < MAX_PLY && killers[ply][0] != square) {
+		killers[ply][1] = killers[ply][0];
+		killers[ply][0] = square;
+	}
+
+	history[square] += remainingDepth * remainingDepth;
+	if (history[square] > HISTORY_LIMIT) {
+		for (int i = 0; i < 64; ++i) {
+			history[i] /= 2;
+		}
+	}
+}
+
+double MoveOrderer::FirstMoveCutoffRate() {
+	return cutoffs ? 100.0 * firstMoveCutoffs / cutoffs : 0;
+}
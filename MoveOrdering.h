@@ -0,0 +1,50 @@
+#ifndef MOVEORDERING_H
+#define MOVEORDERING_H
+
+#include "Utils.h"
+
+#include <cstdint>
+
+// Decides the order that a node's moves are searched in, so that alpha-beta cutoffs happen as early as possible;
+// keeps killer moves and history scores between iterations, so one should be used for the whole of a move's search
+class MoveOrderer {
+
+public:
+
+	// No line in Othello can be longer than this
+	static const int MAX_PLY = 64;
+
+	// Number of nodes that had a cutoff, and how many of those were caused by the first move tried
+	long long cutoffs;
+	long long firstMoveCutoffs;
+
+	MoveOrderer();
+
+	// Forgets killer moves and ages the history scores; should be called before each new move's search
+	void NewSearch();
+
+	// Fills order with the indices into moves in the order they should be searched
+	// (hash move first, then killers for the ply, then by history and static square value)
+	void Order(const MoveList &, int, int, int *);
+
+	// Records that the move on the given square caused a cutoff at a ply with the given remaining depth;
+	// moveNumber is its position in the ordering
+	void RecordCutoff(int, int, int, int);
+
+	// Percentage of cutoffs caused by the first move searched
+	double FirstMoveCutoffRate();
+
+private:
+
+	// Two most recent cutoff moves at each ply
+	int killers[MAX_PLY][2];
+
+	// How much each square has been worth cutting off on, weighted by remaining depth
+	int history[64];
+
+	// Cheap static ranking of squares: corners first, X-squares (diagonally next to corners) last
+	static const int squareRank[64];
+
+};
+
+#endif
@@ -0,0 +1,201 @@
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "OpeningBook.h"
+#include "Bitboard.h"
+#include "TranspositionTable.h"
+#include "GameArchive.h"
+
+const char OpeningBook::MAGIC[8] = { 'O', 'T', 'H', 'B', 'O', 'O', 'K', '2' };
+
+OpeningBook::OpeningBook() {
+	memory = NULL;
+	memorySize = 0;
+	records = NULL;
+	recordCount = 0;
+}
+
+OpeningBook::~OpeningBook() {
+	Close();
+}
+
+bool OpeningBook::Open(const std::string & fileName) {
+	Close();
+
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) < 0 || (size_t) info.st_size < HEADER_SIZE) {
+		close(fd);
+		return false;
+	}
+	void * mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // The mapping keeps the file open
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+
+	const unsigned char * bytes = (const unsigned char *) mapped;
+	uint64_t count;
+	memcpy(&count, bytes + 8, sizeof(count));
+	if (memcmp(bytes, MAGIC, sizeof(MAGIC)) || info.st_size != (off_t) (HEADER_SIZE + count * sizeof(Record))) {
+		munmap(mapped, info.st_size);
+		return false;
+	}
+
+	// Lookups are binary searches, so reading ahead would only pull in pages we don't need
+	madvise(mapped, info.st_size, MADV_RANDOM);
+
+	memory = mapped;
+	memorySize = info.st_size;
+	records = (const Record *) (bytes + HEADER_SIZE);
+	recordCount = count;
+	return true;
+}
+
+void OpeningBook::Close() {
+	if (memory) {
+		munmap(memory, memorySize);
+	}
+	memory = NULL;
+	memorySize = 0;
+	records = NULL;
+	recordCount = 0;
+}
+
+bool OpeningBook::Lookup(GameState state, int * square) {
+	if (!records) {
+		return false;
+	}
+
+	int symmetry;
+	uint64_t key = TranspositionTable::CanonicalHash(state, &symmetry);
+
+	// Binary search for the first record of the position
+	size_t low = 0, high = recordCount;
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (records[middle].key < key) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	// Map each of its moves back onto the actual board; one that isn't legal there belongs to another position with the same key
+	uint64_t moves = Bitboard::Moves(state.own, state.opp);
+	int inverse = Bitboard::InverseSymmetry(symmetry);
+	uint32_t bestCount = 0;
+	for (size_t i = low; i < recordCount && records[i].key == key; ++i) {
+		int s = records[i].move < 64 ? Bitboard::TransformSquare(records[i].move, inverse) : 64;
+		if (s < 64 && (moves & (1ULL << s)) && records[i].count > bestCount) {
+			bestCount = records[i].count;
+			*square = s;
+		}
+	}
+	return bestCount > 0;
+}
+
+std::vector<int> OpeningBook::ParseMoves(const std::string & line) {
+	std::vector<int> moves;
+	for (size_t i = 0; i + 1 < line.size(); ) {
+		char letter = tolower(line[i]);
+		if (letter < 'a' || letter > 'h' || line[i + 1] < '1' || line[i + 1] > '8') {
+			++i; // Skip separators
+			continue;
+		}
+		moves.push_back((line[i + 1] - '1') * 8 + (letter - 'a'));
+		i += 2;
+	}
+	return moves;
+}
+
+// Counts every (position, move) pair along the game, keyed the same way as the book, for its first maxPlies moves;
+// returns the number of moves counted, or -1 - i if move i is illegal (the moves before it are still counted)
+template <typename Square>
+static int countGame(GameState state, const Square * moves, int moveCount, int maxPlies, std::map<std::pair<uint64_t, int>, uint32_t> & counts) {
+	int plies = 0;
+	for (int i = 0; i < moveCount && plies < maxPlies; ++i) {
+		int square = moves[i];
+
+		// Passes aren't written in the games, so hand over the turn when there is no move
+		if (!Bitboard::Moves(state.own, state.opp)) {
+			state = GameState::Pass(state);
+		}
+		if (!(Bitboard::Moves(state.own, state.opp) & (1ULL << square))) {
+			return -1 - i;
+		}
+
+		int symmetry;
+		uint64_t key = TranspositionTable::CanonicalHash(state, &symmetry);
+		++counts[std::make_pair(key, Bitboard::TransformSquare(square, symmetry))];
+		state = GameState::ApplyMove(state, (1ULL << square) | Bitboard::Flips(state.own, state.opp, square));
+		++plies;
+	}
+	return plies;
+}
+
+int OpeningBook::Build(const std::string & gamesName, const std::string & bookName, int maxPlies) {
+	std::map<std::pair<uint64_t, int>, uint32_t> counts;
+	int used = 0;
+
+	// A game archive is read in place; anything else is taken to be text
+	GameArchiveReader archive;
+	if (archive.Open(gamesName)) {
+		GameArchiveReader::Entry game;
+		for (int gameNumber = 1; archive.Next(&game); ++gameNumber) {
+			int plies = countGame(game.Start(), game.moves, game.header->moveCount, maxPlies, counts);
+			if (plies < 0) {
+				std::cout << "Game " << gameNumber << ": illegal move " << Location::FromSquare(game.moves[-1 - plies]).Name()
+					<< ", skipping the rest of the game" << std::endl;
+			} else if (plies > 0) {
+				++used;
+			}
+		}
+	} else {
+		std::ifstream games(gamesName.c_str());
+		if (!games.is_open()) {
+			return -1;
+		}
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(games, line)) {
+			++lineNumber;
+			std::vector<int> moves = ParseMoves(line);
+			int plies = moves.empty() ? 0 : countGame(GameState::Start(), &moves[0], moves.size(), maxPlies, counts);
+			if (plies < 0) {
+				std::cout << "Line " << lineNumber << ": illegal move " << Location::FromSquare(moves[-1 - plies]).Name()
+					<< ", skipping the rest of the line" << std::endl;
+			} else if (plies > 0) {
+				++used;
+			}
+		}
+	}
+
+	std::ofstream book(bookName.c_str(), std::ios::binary);
+	if (!book.is_open()) {
+		return -1;
+	}
+	uint64_t count = counts.size();
+	book.write(MAGIC, sizeof(MAGIC));
+	book.write((const char *) &count, sizeof(count));
+	for (std::map<std::pair<uint64_t, int>, uint32_t>::iterator it = counts.begin(); it != counts.end(); ++it) {
+		Record record;
+		memset(&record, 0, sizeof(record));
+		record.key = it->first.first;
+		record.move = it->first.second;
+		record.count = it->second;
+		book.write((const char *) &record, sizeof(record));
+	}
+	return used;
+}
@@ -0,0 +1,68 @@
+#ifndef OPENINGBOOK_H
+#define OPENINGBOOK_H
+
+#include "Utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Opening book kept in a file of fixed size records sorted by position key, which is memory mapped
+// rather than read in, so opening even a very large book costs nothing until positions are looked up.
+//
+// File layout (little-endian, as the records are used in place):
+//   8 bytes   "OTHBOOK2"
+//   uint64    number of records
+//   records   sorted by key, then by move
+// Positions are keyed by the hash of their canonical form (see GameState::Canonical), so every rotation
+// and reflection of a position shares its records. Moves are stored as they are on the canonical board
+class OpeningBook {
+
+public:
+
+	struct Record {
+		uint64_t key;
+		uint32_t count; // Number of book lines that play this move here
+		uint8_t move; // Square, on the canonical board
+		uint8_t reserved[3];
+	};
+
+	OpeningBook();
+	~OpeningBook();
+
+	// Maps the book file; returns false (with the book closed) if it can't be mapped or isn't a book
+	bool Open(const std::string &);
+
+	void Close();
+
+	bool IsOpen() { return records != NULL; }
+	size_t Size() { return recordCount; }
+
+	// Finds the book's most played move in the state, if there is one
+	bool Lookup(GameState, int * square);
+
+	// Builds a book from a game archive (see GameArchive), or a text file of games, one per line, written as moves
+	// like f5d6c3 (column letter then row number); every position along every game gets its next move.
+	// Games stop being read after maxPlies moves. Returns the number of games used, or -1 if a file can't be opened
+	static int Build(const std::string & games, const std::string & book, int maxPlies);
+
+	// Squares of the moves in a game written like f5d6c3 (column letter then row number), ignoring anything else on the line
+	static std::vector<int> ParseMoves(const std::string &);
+
+private:
+
+	static const char MAGIC[8];
+	static const size_t HEADER_SIZE = 16;
+
+	void * memory;
+	size_t memorySize;
+	const Record * records;
+	size_t recordCount;
+
+	OpeningBook(const OpeningBook &);
+	OpeningBook & operator=(const OpeningBook &);
+
+};
+
+#endif
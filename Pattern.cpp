@@ -0,0 +1,203 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "Pattern.h"
+#include "Bitboard.h"
+
+int Pattern::size[FEATURES];
+int Pattern::squares[FEATURES][10];
+Pattern::Type Pattern::type[FEATURES];
+int Pattern::squareCount[64];
+uint8_t Pattern::squareFeature[64][MAX_SQUARE_FEATURES];
+uint16_t Pattern::squarePower[64][MAX_SQUARE_FEATURES];
+const int Pattern::typeSize[TYPES] = { 9, 10, 10, 8, 8, 8, 8, 7, 6, 5, 4 };
+int Pattern::typeOffset[TYPES];
+int Pattern::phaseSize = 0;
+int Pattern::phases = 0;
+uint64_t Pattern::checksum = 0;
+std::vector<int16_t> Pattern::weights[2];
+
+// Lay out the features before main runs
+bool Pattern::featuresInitialized = Pattern::initFeatures();
+
+bool Pattern::initFeatures() {
+	// Each pattern as it sits in the top left corner (or along the top edge), as (row, column) pairs
+	static const int corner3x3[9][2] = { {0, 0}, {0, 1}, {0, 2}, {1, 0}, {1, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2} };
+	static const int corner2x5[10][2] = { {0, 0}, {0, 1}, {0, 2}, {0, 3}, {0, 4}, {1, 0}, {1, 1}, {1, 2}, {1, 3}, {1, 4} };
+	static const int edge2x[10][2] = { {0, 0}, {0, 1}, {0, 2}, {0, 3}, {0, 4}, {0, 5}, {0, 6}, {0, 7}, {1, 1}, {1, 6} };
+	static const int line2[8][2] = { {1, 0}, {1, 1}, {1, 2}, {1, 3}, {1, 4}, {1, 5}, {1, 6}, {1, 7} };
+	static const int line3[8][2] = { {2, 0}, {2, 1}, {2, 2}, {2, 3}, {2, 4}, {2, 5}, {2, 6}, {2, 7} };
+	static const int line4[8][2] = { {3, 0}, {3, 1}, {3, 2}, {3, 3}, {3, 4}, {3, 5}, {3, 6}, {3, 7} };
+	static const int diagonal8[8][2] = { {0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}, {6, 6}, {7, 7} };
+	static const int diagonal7[7][2] = { {0, 1}, {1, 2}, {2, 3}, {3, 4}, {4, 5}, {5, 6}, {6, 7} };
+	static const int diagonal6[6][2] = { {0, 2}, {1, 3}, {2, 4}, {3, 5}, {4, 6}, {5, 7} };
+	static const int diagonal5[5][2] = { {0, 3}, {1, 4}, {2, 5}, {3, 6}, {4, 7} };
+	static const int diagonal4[4][2] = { {0, 4}, {1, 5}, {2, 6}, {3, 7} };
+
+	// Symmetries 0-3 rotate the board a quarter turn at a time, and 4-7 mirror it along the main diagonal first.
+	// Each pattern uses the ones that put it somewhere different
+	static const int rotations[4] = { 0, 1, 2, 3 };
+	static const int all[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+	int feature = 0;
+	addFeatures(CORNER_3X3, corner3x3, 9, rotations, 4, &feature);
+	addFeatures(CORNER_2X5, corner2x5, 10, all, 8, &feature);
+	addFeatures(EDGE_2X, edge2x, 10, rotations, 4, &feature);
+	addFeatures(LINE_2, line2, 8, rotations, 4, &feature);
+	addFeatures(LINE_3, line3, 8, rotations, 4, &feature);
+	addFeatures(LINE_4, line4, 8, rotations, 4, &feature);
+	addFeatures(DIAGONAL_8, diagonal8, 8, rotations, 2, &feature);
+	addFeatures(DIAGONAL_7, diagonal7, 7, rotations, 4, &feature);
+	addFeatures(DIAGONAL_6, diagonal6, 6, rotations, 4, &feature);
+	addFeatures(DIAGONAL_5, diagonal5, 5, rotations, 4, &feature);
+	addFeatures(DIAGONAL_4, diagonal4, 4, rotations, 4, &feature);
+
+	// Digit values for the incremental updates
+	memset(squareCount, 0, sizeof(squareCount));
+	for (int f = 0; f < FEATURES; ++f) {
+		int power = 1;
+		for (int k = size[f] - 1; k >= 0; --k) {
+			int square = squares[f][k];
+			squareFeature[square][squareCount[square]] = f;
+			squarePower[square][squareCount[square]] = power;
+			++squareCount[square];
+			power *= 3;
+		}
+	}
+
+	// Every type's table, one after the other
+	phaseSize = 0;
+	for (int t = 0; t < TYPES; ++t) {
+		typeOffset[t] = phaseSize;
+		phaseSize += typeEntries(t);
+	}
+	return true;
+}
+
+void Pattern::addFeatures(Type t, const int (*pattern)[2], int n, const int * symmetries, int count, int * feature) {
+	for (int s = 0; s < count; ++s) {
+		int f = (*feature)++;
+		type[f] = t;
+		size[f] = n;
+		for (int k = 0; k < n; ++k) {
+			int row = pattern[k][0], column = pattern[k][1];
+			if (symmetries[s] >= 4) {
+				int temp = row;
+				row = column;
+				column = temp;
+			}
+			for (int r = 0; r < symmetries[s] % 4; ++r) {
+				int temp = row;
+				row = column;
+				column = 7 - temp;
+			}
+			squares[f][k] = row * 8 + column;
+		}
+	}
+}
+
+int Pattern::typeEntries(int t) {
+	int entries = 1;
+	for (int k = 0; k < typeSize[t]; ++k) {
+		entries *= 3;
+	}
+	return entries;
+}
+
+bool Pattern::Load(const std::string & fileName) {
+	std::ifstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (data.size() < 12 || memcmp(&data[0], "OTHPAT01", 8)) {
+		return false;
+	}
+	int count = data[8] | (data[9] << 8) | (data[10] << 16) | (data[11] << 24);
+	if (count <= 0 || data.size() != 12 + (size_t) count * phaseSize * 2) {
+		return false;
+	}
+
+	weights[0].resize((size_t) count * phaseSize);
+	weights[1].resize((size_t) count * phaseSize);
+	for (size_t i = 0; i < weights[0].size(); ++i) {
+		weights[0][i] = (int16_t) (data[12 + 2 * i] | (data[13 + 2 * i] << 8));
+	}
+
+	// The opponent's tables: the same weights with every 1 digit swapped for a 2 and back
+	for (int p = 0; p < count; ++p) {
+		for (int t = 0; t < TYPES; ++t) {
+			int16_t * from = &weights[0][(size_t) p * phaseSize + typeOffset[t]];
+			int16_t * to = &weights[1][(size_t) p * phaseSize + typeOffset[t]];
+			for (int index = 0; index < typeEntries(t); ++index) {
+				int swapped = 0;
+				int rest = index;
+				int power = 1;
+				for (int k = 0; k < typeSize[t]; ++k) {
+					int digit = rest % 3;
+					rest /= 3;
+					swapped += (digit ? 3 - digit : 0) * power;
+					power *= 3;
+				}
+				to[swapped] = from[index];
+			}
+		}
+	}
+
+	// FNV-1a over the whole file
+	checksum = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < data.size(); ++i) {
+		checksum = (checksum ^ data[i]) * 0x100000001b3ULL;
+	}
+	phases = count;
+	return true;
+}
+
+void Pattern::Compute(GameState state, bool maxNode, Features * features) {
+	uint64_t first = maxNode ? state.own : state.opp;
+	uint64_t second = maxNode ? state.opp : state.own;
+	for (int f = 0; f < FEATURES; ++f) {
+		int index = 0;
+		for (int k = 0; k < size[f]; ++k) {
+			uint64_t bit = 1ULL << squares[f][k];
+			index = index * 3 + ((first & bit) ? 1 : ((second & bit) ? 2 : 0));
+		}
+		features->index[f] = index;
+	}
+}
+
+void Pattern::Play(const Features & before, int square, uint64_t changed, bool maxNode, Features * after) {
+	*after = before;
+
+	// The new disc goes from 0 to the mover's digit, and each flipped disc from the other digit to the mover's
+	int digit = maxNode ? 1 : 2;
+	for (int i = 0; i < squareCount[square]; ++i) {
+		after->index[squareFeature[square][i]] += digit * squarePower[square][i];
+	}
+	for (uint64_t flips = changed & ~(1ULL << square); flips; flips &= flips - 1) {
+		int s = Bitboard::FirstSquare(flips);
+		for (int i = 0; i < squareCount[s]; ++i) {
+			if (maxNode) {
+				after->index[squareFeature[s][i]] -= squarePower[s][i];
+			} else {
+				after->index[squareFeature[s][i]] += squarePower[s][i];
+			}
+		}
+	}
+}
+
+double Pattern::Evaluate(const Features & features, int empties, bool maxNode) {
+	int phase = (60 - empties) * phases / 61;
+	if (phase < 0) {
+		phase = 0;
+	}
+	const int16_t * table = &weights[maxNode ? 0 : 1][(size_t) phase * phaseSize];
+
+	int score = 0;
+	for (int f = 0; f < FEATURES; ++f) {
+		score += table[typeOffset[type[f]] + features.index[f]];
+	}
+	return score;
+}
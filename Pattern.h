@@ -0,0 +1,88 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include "Utils.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Pattern-table evaluation: the board is covered by 46 overlapping patterns (corners, edges, lines and diagonals),
+// each pattern's contents are read as a base 3 number, and the score is the sum of one table lookup per pattern.
+// The pattern numbers are kept up to date move by move during the search, so a leaf costs 46 lookups.
+//
+// Weights are loaded from a binary file (all numbers little-endian):
+//   8 bytes   "OTHPAT01"
+//   uint32    number of phases P (the game is split evenly by number of discs)
+//   P times:  for each pattern type, in the order of the Type enum, 3^size int16 weights
+// A weight is indexed by its pattern read from the first square to the last (the first square being the
+// most significant digit), with 0 for an empty square, 1 for the player to move and 2 for their opponent.
+// Scores are from the player to move's point of view, in whatever units the weights were trained in
+class Pattern {
+
+public:
+
+	enum Type { CORNER_3X3, CORNER_2X5, EDGE_2X, LINE_2, LINE_3, LINE_4, DIAGONAL_8, DIAGONAL_7, DIAGONAL_6, DIAGONAL_5, DIAGONAL_4, TYPES };
+
+	static const int FEATURES = 46;
+
+	// The pattern numbers of a position. Digits are not relative to the player to move (which would mean
+	// renumbering every pattern on every move) but to the player to move at the search's max nodes:
+	// 1 for their discs and 2 for their opponent's
+	struct Features {
+		uint16_t index[FEATURES];
+	};
+
+	// Loads weights from the file; returns false (leaving any previously loaded weights alone) if it can't be read
+	static bool Load(const std::string &);
+
+	// True once weights have been loaded; until then the search uses the hand written heuristic
+	static bool Loaded() { return phases > 0; }
+
+	// Hash of the loaded weights file, so that results searched with different weights can be told apart; 0 until weights are loaded
+	static uint64_t Checksum() { return checksum; }
+
+	// Computes the pattern numbers from scratch, for a state seen from a max node (maxNode true) or a min node
+	static void Compute(GameState, bool maxNode, Features *);
+
+	// Updates the pattern numbers for a move: square is the disc that was placed and changed has it and the flipped discs.
+	// maxNode is true if the player at the search's max nodes made the move
+	static void Play(const Features &, int square, uint64_t changed, bool maxNode, Features *);
+
+	// Score of the position from the point of view of the player to move
+	static double Evaluate(const Features &, int empties, bool maxNode);
+
+private:
+
+	// Squares covered by each feature, most significant digit first
+	static int size[FEATURES];
+	static int squares[FEATURES][10];
+	static Type type[FEATURES];
+
+	// For each square, the features covering it and the value of one digit on that square
+	static const int MAX_SQUARE_FEATURES = 8;
+	static int squareCount[64];
+	static uint8_t squareFeature[64][MAX_SQUARE_FEATURES];
+	static uint16_t squarePower[64][MAX_SQUARE_FEATURES];
+
+	// Squares in each type of pattern, where its weights start within a phase, and how many weights a phase has
+	static const int typeSize[TYPES];
+	static int typeEntries(int);
+	static int typeOffset[TYPES];
+	static int phaseSize;
+
+	// weights[0] is for when the max node player is to move, and weights[1] the same tables
+	// with the digits 1 and 2 swapped, for when their opponent is
+	static int phases;
+	static uint64_t checksum;
+	static std::vector<int16_t> weights[2];
+
+	static bool featuresInitialized;
+	static bool initFeatures();
+
+	// Adds a feature for each of the given symmetries of a pattern on the board
+	static void addFeatures(Type, const int (*)[2], int, const int *, int, int *);
+
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Move generator check: counts the leaf nodes of the game tree to a fixed depth
+ * and compares them with known counts, timing each run.
+ *
+ * Passes count as a ply, and a finished game counts as a single leaf however deep it is.
+ * The start position counts are the standard Othello perft numbers; the test file counts
+ * come from the original board-array move generator.
+ *
+ * Usage: perft [maximum depth, 10 by default]
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "Game.h"
+
+using namespace std;
+
+struct Reference {
+	const char * fileName; // NULL for the start position
+	int depth;
+	long long nodes;
+};
+
+static const Reference references[] = {
+	{ NULL, 1, 4 },
+	{ NULL, 2, 12 },
+	{ NULL, 3, 56 },
+	{ NULL, 4, 244 },
+	{ NULL, 5, 1396 },
+	{ NULL, 6, 8200 },
+	{ NULL, 7, 55092 },
+	{ NULL, 8, 390216 },
+	{ NULL, 9, 3005288 },
+	{ NULL, 10, 24571284 },
+	{ NULL, 11, 212258800 },
+	{ "Testfile.txt", 1, 7 },
+	{ "Testfile.txt", 4, 1852 },
+	{ "Testfile.txt", 7, 1365045 },
+	{ "Testfile2.txt", 1, 7 },
+	{ "Testfile2.txt", 4, 2972 },
+	{ "Testfile2.txt", 7, 2155107 },
+	{ "Testfile3.txt", 1, 1 },
+	{ "Testfile3.txt", 3, 1 },
+	{ "Testfile4.txt", 1, 8 },
+	{ "Testfile4.txt", 4, 2739 },
+	{ "Testfile4.txt", 7, 1764209 },
+};
+
+static long long perft(GameState state, int depth, bool passed) {
+	if (depth == 0) {
+		return 1;
+	}
+
+	vector<Location> moves = Game::LegalMoves(state);
+	if (moves.empty()) {
+		// Neither side can move, so the game is over
+		if (passed) {
+			return 1;
+		}
+		return perft(GameState::Pass(state), depth - 1, true);
+	}
+
+	// Every move at the last ply is a leaf, so there's no need to play them
+	if (depth == 1) {
+		return moves.size();
+	}
+
+	long long nodes = 0;
+	for (unsigned int i = 0; i < moves.size(); ++i) {
+		nodes += perft(GameState::ApplyMove(state, Game::GetChangedPieces(state, moves[i])), depth - 1, false);
+	}
+	return nodes;
+}
+
+int main(int argc, char * argv[]) {
+	int maxDepth = argc > 1 ? atoi(argv[1]) : 10;
+
+	int failures = 0;
+	long long totalNodes = 0;
+	double totalSeconds = 0;
+	for (unsigned int i = 0; i < sizeof(references) / sizeof(references[0]); ++i) {
+		const Reference & reference = references[i];
+		if (reference.depth > maxDepth) {
+			continue;
+		}
+
+		GameState state = GameState::Start();
+		if (reference.fileName) {
+			state = Game::FromFile(reference.fileName, false, false).GetCurrentState();
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		long long nodes = perft(state, reference.depth, false);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		totalNodes += nodes;
+		totalSeconds += seconds;
+
+		bool passed = nodes == reference.nodes;
+		if (!passed) {
+			++failures;
+		}
+		cout << (reference.fileName ? reference.fileName : "start") << " depth " << reference.depth << ": " << nodes << " nodes";
+		if (!passed) {
+			cout << " (expected " << reference.nodes << ")";
+		}
+		cout << ", " << seconds << " seconds, " << (long long) (nodes / (seconds > 0 ? seconds : 1e-9)) << " nodes/sec"
+			<< (passed ? "" : "  MISMATCH") << endl;
+	}
+
+	cout << endl << "Total: " << totalNodes << " nodes in " << totalSeconds << " seconds, "
+		<< (long long) (totalNodes / (totalSeconds > 0 ? totalSeconds : 1e-9)) << " nodes/sec" << endl;
+	if (failures) {
+		cout << failures << " counts did not match" << endl;
+		return 1;
+	}
+	cout << "All counts match" << endl;
+	return 0;
+}
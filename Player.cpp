@@ -1,12 +1,23 @@
 #include <iostream>
 #include <climits>
-#include <ctime>
+#include <chrono>
+#include <thread>
+#include <mutex>
 #include <algorithm>
+#include <limits>
 
 #include "Player.h"
 #include "Game.h"
+#include "Bitboard.h"
+#include "SearchPool.h"
+#include "Endgame.h"
+#include "ProbCut.h"
 
-int Player::count = 0;
+std::atomic<int> Player::count(0);
+int ComputerPlayer::threads = 1;
+ComputerPlayer::ParallelMode ComputerPlayer::parallelMode = ComputerPlayer::LAZY_SMP;
+bool ComputerPlayer::verbose = true;
+std::atomic<bool> ComputerPlayer::ponder(false);
 
 Player::Player() {
 	id = ++count;
@@ -16,67 +27,411 @@ int Player::GetId() {
 	return id;
 }
 
+ComputerPlayer::ComputerPlayer(int depth, long long nodes) : threadCount(0), depthLimit(depth), nodeLimit(nodes), probCut(true), agesTable(true), activeStop(NULL), stopRequested(false), ponderStop(false), ponderDepth(1) { }
+
+// Deepest iteration completed by any of the helper threads
+struct HelperResult {
+	std::mutex lock;
+	int depth;
+	MoveVal move;
+};
+
+// Lazy SMP helper: runs its own iterative deepening on the root until told to stop or it reaches maxDepth,
+// sharing what it finds with the other threads through the transposition table
+static void helperSearch(GameState state, int firstDepth, int maxDepth, SearchContext * context, HelperResult * result) {
+	for (int depth = firstDepth; depth <= maxDepth; ++depth) {
+		context->depthTracker = 0;
+		MoveVal move = Game::MinimaxSearch(state, INT_MIN, INT_MAX, 0, depth, context);
+		if (context->TimedOut()) {
+			break;
+		}
+
+		std::lock_guard<std::mutex> guard(result->lock);
+		if (depth > result->depth) {
+			result->depth = depth;
+			result->move = move;
+		}
+	}
+}
+
 Location ComputerPlayer::MakeMove(GameState state) {
+	return MakeMove(state, std::chrono::steady_clock::now());
+}
+
+double ComputerPlayer::MoveBudget(GameState state) {
+	if (depthLimit > 0 || nodeLimit > 0) {
+		return 0;
+	}
+	return timeManager.Budget(64 - Bitboard::Count(state.own | state.opp));
+}
+
+Location ComputerPlayer::MakeMove(GameState state, std::chrono::steady_clock::time_point requested) {
 	/*
 	 * Minimax Driver
 	 */
 
-	// Set up time limit
-	clock_t startTime = std::clock();
-	clock_t upperTimeLimit = std::clock() + Game::timeLimit * (clock_t) CLOCKS_PER_SEC;
-
-	// Get enemy id
-	int enemyId, currentId = id;
-	for (int i = 0; i < 8; ++i) {
-		bool found = false;
-		for (int j = 0; j < 8; ++j) {
-			if (state.board[i][j] && state.board[i][j] != currentId) {
-				enemyId = state.board[i][j];
-				found = true;
-				break;
+	// The ponder search is only worth carrying on with if it guessed the opponent's move right
+	bool ponderHit = stopPondering() && state == ponderState;
+
+	// Set up time limit; searches limited by depth or nodes don't have one
+	int emptySquares = 64 - Bitboard::Count(state.own | state.opp); // No line can be longer than this
+	timeManager.StartMove(emptySquares, requested);
+	bool fixed = depthLimit > 0 || nodeLimit > 0;
+	std::chrono::steady_clock::time_point deadline = fixed ? std::chrono::steady_clock::time_point::max() : timeManager.HardDeadline();
+
+	// Let the transposition table know that entries from previous moves are getting old
+	if (agesTable) {
+		Game::transpositionTable.NewSearch();
+	}
+
+	// One context per thread; the first one belongs to this thread
+	std::atomic<bool> stop(false);
+	std::atomic<long long> searchNodes(0);
+	{
+		std::lock_guard<std::mutex> guard(stopLock);
+		activeStop = &stop;
+		stop = stopRequested;
+	}
+	contexts.resize(std::max(1, threadCount > 0 ? threadCount : threads));
+	for (unsigned int i = 0; i < contexts.size(); ++i) {
+		contexts[i].Start(deadline, &stop, nodeLimit, nodeLimit && contexts.size() > 1 ? &searchNodes : NULL);
+		contexts[i].orderer.NewSearch();
+		contexts[i].probCut = probCut;
+	}
+	SearchContext & context = contexts[0];
+
+	SearchStats stats;
+	stats.player = id;
+	stats.empties = emptySquares;
+	stats.ponderHit = ponderHit;
+
+	// Play straight from the book while the game is still in it
+	int bookSquare;
+	if (Game::openingBook.Lookup(state, &bookSquare)) {
+		if (verbose) {
+			std::cout << "Playing book move" << std::endl;
+		}
+		stats.source = SearchStats::BOOK;
+		stats.move = bookSquare;
+		stats.principalVariation.push_back(bookSquare);
+		endMove(stats);
+		return Location::FromSquare(bookSquare);
+	}
+
+	// Close enough to the end to search all the way there, rather than trusting the heuristic. A depth limit caps
+	// how close that has to be, and a node limit holds for the solver too: if it runs out, the move is searched
+	// as usual instead, under the same limit, so a node limited move searches at most about twice its nodes
+	int solveEmpties = std::max(Endgame::exactEmpties, Endgame::wldEmpties);
+	if (depthLimit > 0) {
+		solveEmpties = std::min(solveEmpties, depthLimit);
+	}
+	if (emptySquares <= solveEmpties) {
+		bool wld = emptySquares > Endgame::exactEmpties;
+		int square, score;
+		long long nodes;
+		bool solved = Endgame::SolveRoot(state, wld, &context, &square, &score, &nodes);
+		if (!solved && nodeLimit > 0) {
+			if (verbose) {
+				std::cout << "Out of nodes solving the endgame after " << nodes << " positions, searching instead" << std::endl;
+			}
+			stats.nodes = nodes;
+		} else {
+			if (verbose) {
+				if (!solved) {
+					std::cout << "Out of time solving the endgame" << std::endl;
+				} else if (wld) {
+					std::cout << "Solved endgame: " << (score > 0 ? "win" : (score < 0 ? "loss" : "draw")) << std::endl;
+				} else {
+					std::cout << "Solved endgame: final disc difference " << score << std::endl;
+				}
+				std::cout << "Searched " << nodes << " positions" << std::endl;
 			}
+			stats.source = SearchStats::ENDGAME;
+			stats.move = square;
+			stats.score = score;
+			stats.depth = solved ? emptySquares : 0;
+			stats.nodes = nodes;
+			stats.principalVariation.push_back(square);
+			endMove(stats);
+			return Location::FromSquare(square);
 		}
-		if (found) {
-			break;
+	}
+
+	// Start the helpers. With lazy SMP every other one starts a ply deeper so that they don't all search the same tree in lockstep;
+	// with Young Brothers Wait they sit in a pool and take moves from the split points this thread creates
+	HelperResult helperResult;
+	helperResult.depth = 0;
+	std::vector<std::thread> helpers;
+	SearchPool * pool = NULL;
+	if (parallelMode == YOUNG_BROTHERS_WAIT && contexts.size() > 1) {
+		pool = new SearchPool(contexts);
+	} else {
+		// A depth limit holds for the helpers too, or one of them could hand back a deeper search than was asked for
+		int helperDepth = depthLimit > 0 ? std::min(emptySquares, depthLimit) : emptySquares;
+		for (unsigned int i = 1; i < contexts.size(); ++i) {
+			helpers.push_back(std::thread(helperSearch, state, 1 + i % 2, helperDepth, &contexts[i], &helperResult));
 		}
 	}
 
-	// Iterative deepening search
-	int maxDepth = INT_MAX; // Set to maximum int value for ideal case
+	// Iterative deepening search, carrying on from the ponder search if it was of this position
 	int depth;
-	MoveVal move, oldMove;
-	int oldTracker = -1; // If the depth searched is the same over two runs, then we break out since we've exhausted the tree
-	for (depth = 1; depth < maxDepth; ++depth) { // Start searching up to depth 1 since searching up to depth 0 does nothing
-		// Get minimax chosen move
-		int depthTracker = 0; // Used to check if we are out of states to check (compare with oldTracker)
-		move = Game::MinimaxSearch(state, INT_MIN, INT_MAX, 0, depth, currentId, enemyId, upperTimeLimit, &depthTracker);
+	MoveVal move;
+	if (ponderHit) {
+		if (verbose) {
+			std::cout << "Ponder hit, continuing from depth " << ponderDepth << std::endl;
+		}
+		move = deepen(state, context, ponderDepth, ponderMove, !fixed, verbose, &stats, &depth);
+	} else {
+		move = deepen(state, context, 1, MoveVal(), !fixed, verbose, &stats, &depth);
+	}
 
-		// Check if we have reached the end of the tree
-		if (depthTracker == oldTracker) {
+	// Stop the helpers, and take a helper's move if it got further than we did
+	stop = true;
+	for (unsigned int i = 0; i < helpers.size(); ++i) {
+		helpers[i].join();
+	}
+	if (pool) {
+		pool->Stop();
+		std::vector<SearchPool::ThreadStats> stats = pool->GetStats();
+		for (unsigned int i = 0; verbose && i < stats.size(); ++i) {
+			std::cout << "Thread " << i << ": " << stats[i].tasks << " tasks, " << stats[i].steals << " steals, "
+				<< stats[i].idleSeconds << " seconds idle" << std::endl;
+		}
+		delete pool;
+	}
+	if (helperResult.depth > depth - 1) {
+		if (verbose) {
+			std::cout << "Using helper thread's search of depth " << helperResult.depth << std::endl;
+		}
+		depth = helperResult.depth + 1;
+		move = helperResult.move;
+	}
+
+	// A search stopped before it finished a single move has nothing to go on, but still has to play something legal
+	uint64_t legal = Bitboard::Moves(state.own, state.opp);
+	if (legal && !(legal & (1ULL << move.move.square))) {
+		move.move = Location::FromSquare(Bitboard::FirstSquare(legal));
+	}
+
+	if (verbose) {
+		std::cout << "Completed search of depth " << depth - 1 << std::endl;
+		std::cout << "First move caused " << context.orderer.FirstMoveCutoffRate() << "% of " << context.orderer.cutoffs << " cutoffs" << std::endl;
+	}
+
+	stats.move = move.move.square;
+	stats.score = move.value;
+	stats.depth = depth - 1;
+	for (unsigned int i = 0; i < contexts.size(); ++i) {
+		stats.nodes += contexts[i].nodes;
+		stats.leafEvaluations += contexts[i].leafEvaluations;
+		stats.expandedNodes += contexts[i].expandedNodes;
+		stats.tableProbes += contexts[i].tableProbes;
+		stats.tableHits += contexts[i].tableHits;
+		stats.cacheHits += contexts[i].cacheHits;
+		stats.probCuts += contexts[i].probCuts;
+		stats.cutoffs += contexts[i].orderer.cutoffs;
+		stats.firstMoveCutoffs += contexts[i].orderer.firstMoveCutoffs;
+	}
+	if (SearchStats::IsOpen()) {
+		stats.principalVariation = Game::PrincipalVariation(state, move.move, std::max(1, depth - 1), probCut && ProbCut::Loaded());
+	}
+	endMove(stats);
+
+	startPondering(state, move.move);
+	return move.move;
+}
+
+void ComputerPlayer::StopThinking() {
+	stopPondering();
+}
+
+void ComputerPlayer::Stop() {
+	std::lock_guard<std::mutex> guard(stopLock);
+	stopRequested = true;
+	if (activeStop) {
+		activeStop->store(true);
+	}
+}
+
+void ComputerPlayer::ClearStop() {
+	std::lock_guard<std::mutex> guard(stopLock);
+	stopRequested = false;
+}
+
+void ComputerPlayer::NewGame() {
+	stopPondering();
+	timeManager.Reset();
+}
+
+ComputerPlayer::~ComputerPlayer() {
+	stopPondering();
+}
+
+void ComputerPlayer::startPondering(GameState state, Location move) {
+	if (!ponder) {
+		return;
+	}
+
+	// Guess the opponent's reply from the transposition table, which has the best move found for the position after ours
+	GameState next = GameState::ApplyMove(state, Game::GetChangedPieces(state, move));
+	if (!MoveList(next).count) {
+		next = GameState::Pass(next); // They have to pass, so there's nothing to guess
+	} else {
+		TranspositionTable::Entry entry;
+		int symmetry;
+		uint64_t key = TranspositionTable::Key(next, probCut && ProbCut::Loaded(), &symmetry);
+		int reply = TranspositionTable::NO_MOVE;
+		if (Game::transpositionTable.Probe(key, &entry)) {
+			reply = TranspositionTable::MoveFromKey(entry.move, symmetry);
+		}
+		if (reply == TranspositionTable::NO_MOVE || !(Bitboard::Moves(next.own, next.opp) & (1ULL << reply))) {
+			return;
+		}
+		next = GameState::ApplyMove(next, Game::GetChangedPieces(next, Location::FromSquare(reply)));
+	}
+
+	// Positions answered from the book or by the endgame solver don't need a search
+	int square;
+	if (!MoveList(next).count || Game::openingBook.Lookup(next, &square)
+		|| 64 - Bitboard::Count(next.own | next.opp) <= std::max(Endgame::exactEmpties, Endgame::wldEmpties)) {
+		return;
+	}
+
+	ponderState = next;
+	ponderStop = false;
+	ponderDepth = 1;
+	ponderMove = MoveVal();
+	if (agesTable) {
+		Game::transpositionTable.NewSearch();
+	}
+	contexts[0].Start(std::chrono::steady_clock::time_point::max(), &ponderStop);
+	contexts[0].orderer.NewSearch();
+	contexts[0].probCut = probCut;
+	ponderThread = std::thread(&ComputerPlayer::ponderSearch, this);
+}
+
+void ComputerPlayer::ponderSearch() {
+	ponderMove = deepen(ponderState, contexts[0], 1, MoveVal(), false, false, NULL, &ponderDepth);
+}
+
+bool ComputerPlayer::stopPondering() {
+	if (!ponderThread.joinable()) {
+		return false;
+	}
+	ponderStop = true;
+	ponderThread.join();
+	return true;
+}
+
+// Iterative deepening on the state from firstDepth, where oldMove is the result of the iteration before it (if there was one);
+// runs until the depth limit, the end of the tree, or the context runs out of time (and, if timed, the soft deadline passes).
+// Each iteration is added to the stats, if given. Returns the move of the deepest usable iteration
+// and sets stoppedDepth to the depth it stopped at, one past the last finished iteration
+MoveVal ComputerPlayer::deepen(GameState state, SearchContext & context, int firstDepth, MoveVal oldMove, bool timed, bool report, SearchStats * stats, int * stoppedDepth) {
+	int emptySquares = 64 - Bitboard::Count(state.own | state.opp); // No line can be longer than this
+	int maxDepth = depthLimit > 0 ? depthLimit + 1 : INT_MAX; // Set to maximum int value for ideal case
+	int & depth = *stoppedDepth;
+	MoveVal move = oldMove;
+	int oldTracker = -1; // If the depth searched is the same over two runs, then we break out since we've exhausted the tree
+	for (depth = firstDepth; depth < maxDepth; ++depth) { // Start searching up to depth 1 since searching up to depth 0 does nothing
+		// Don't start an iteration that has little chance of finishing
+		if (depth > firstDepth && timed && std::chrono::steady_clock::now() > timeManager.SoftDeadline()) {
 			break;
-		} else {
-			oldTracker = depthTracker;
 		}
 
-		// Check for timeout
-		if (std::clock() > upperTimeLimit) {
-			std::cout << "Out of time searching depth " << depth << std::endl;
-			move = oldMove; // Use the previous iteration's move, since the current iteration never finished and is likely incomplete
+		// Search a narrow window around the last iteration's score, since the score rarely moves far from one depth to the next;
+		// when it falls outside, widen that side and search again, until the window is the full range
+		double alpha = INT_MIN, beta = INT_MAX;
+		double window = ASPIRATION_WINDOW;
+		if (depth > 1) {
+			alpha = std::max<double>(INT_MIN, oldMove.value - window);
+			beta = std::min<double>(INT_MAX, oldMove.value + window);
+		}
+		std::chrono::steady_clock::time_point iterationStart = std::chrono::steady_clock::now();
+		long long iterationNodes = context.nodes;
+		while (true) {
+			context.depthTracker = 0; // Used to check if we are out of states to check (compare with oldTracker)
+			context.completedRootMoves = 0;
+			move = Game::MinimaxSearch(state, alpha, beta, 0, depth, &context);
+			if (context.TimedOut()) {
+				break;
+			}
+			window *= 4;
+			if (move.value <= alpha && alpha > INT_MIN) {
+				alpha = std::max<double>(INT_MIN, move.value - window);
+			} else if (move.value >= beta && beta < INT_MAX) {
+				beta = std::min<double>(INT_MAX, move.value + window);
+			} else {
+				break;
+			}
+		}
+
+		if (stats) {
+			SearchStats::Iteration iteration;
+			iteration.depth = depth;
+			iteration.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - iterationStart).count();
+			iteration.nodes = context.nodes - iterationNodes;
+			iteration.completed = !context.TimedOut();
+			stats->iterations.push_back(iteration);
+		}
+
+		// Check for timeout (before the end of the tree, as an unfinished iteration may not have a move to give)
+		if (context.TimedOut()) {
+			// The previous iteration's move is searched first, so if it finished, every other finished move was compared
+			// against it at the deeper depth and the unfinished iteration's choice is at least as good as the previous one's
+			// A search that failed low only has upper bounds on the moves it finished, so it can't tell them apart
+			int oldSquare = oldMove.move.square;
+			bool usable = depth == 1 ? context.completedRootMoves != 0 : (context.completedRootMoves & (1ULL << oldSquare)) != 0;
+			usable = usable && move.value > alpha;
+			if (usable) {
+				if (report) {
+					std::cout << "Out of time searching depth " << depth << ", using the " << Bitboard::Count(context.completedRootMoves)
+						<< " moves that were finished" << std::endl;
+				}
+			} else {
+				if (report) {
+					std::cout << "Out of time searching depth " << depth << std::endl;
+				}
+				move = oldMove; // Use the previous iteration's move, since the current iteration never finished and is likely incomplete
+			}
 			break;
 		} else {
 			oldMove = move; // Set the oldMove if the iteration didn't timeout
 			//std::cout << "Depth " << depth << ": " << move.move << "\t" << move.value << std::endl;
 		}
+
+		// Check if we have reached the end of the tree
+		if (context.depthTracker == oldTracker || depth > emptySquares) {
+			break;
+		} else {
+			oldTracker = context.depthTracker;
+		}
 	}
 
-	std::cout << "Completed search of depth " << depth - 1 << std::endl;
-	std::cout << "Took a total of " << (double)(upperTimeLimit - startTime) / 1000 << " seconds" << std::endl;
+	return move;
+}
 
-	return move.move;
+void ComputerPlayer::endMove(SearchStats & stats) {
+	// Every way out of MakeMove comes through here, and the search's stop flag is about to go out of scope
+	{
+		std::lock_guard<std::mutex> guard(stopLock);
+		activeStop = NULL;
+	}
+	timeManager.EndMove();
+	stats.seconds = timeManager.Elapsed();
+	SearchStats::Write(stats);
+	lastStats = stats;
+	if (!verbose) {
+		return;
+	}
+	std::cout << "Took a total of " << stats.seconds << " seconds" << std::endl;
+	if (timeManager.UsesClock()) {
+		std::cout << timeManager.Remaining() << " seconds left on the clock" << std::endl;
+	}
 }
 
 Location HumanPlayer::MakeMove(GameState state) {
-	Location * pDesiredMove;
+	Location desiredMove;
 	bool isLegal;
 
 	do {
@@ -102,15 +457,15 @@ Location HumanPlayer::MakeMove(GameState state) {
 			}
 		} while (column < 0 || column > 7);
 
-		pDesiredMove = new Location(row, column);
+		desiredMove = Location(row, column);
 
 		// Check if move is legal
-		std::vector<Location> legalMoves = Game::LegalMoves(state, id);
-		isLegal = std::find(legalMoves.begin(), legalMoves.end(), *pDesiredMove) != legalMoves.end();
+		std::vector<Location> legalMoves = Game::LegalMoves(state);
+		isLegal = std::find(legalMoves.begin(), legalMoves.end(), desiredMove) != legalMoves.end();
 		if (!isLegal) {
 			std::cout << "Enter a legal move!" << std::endl;
 		}
 	} while (!isLegal);
 
-	return *pDesiredMove;
+	return desiredMove;
 }
@@ -2,10 +2,18 @@
 #define PLAYER_H
 
 #include "Utils.h"
+#include "SearchContext.h"
+#include "TimeManager.h"
+#include "SearchStats.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 class Player {
 
-	static int count;
+	static std::atomic<int> count;
 
 protected:
 
@@ -16,18 +24,135 @@ public:
 	Player();
 	int GetId();
 
-	// This is implemented differently by each type of player and must be defined in the child class
+	// Players are numbered from 1 in the order they're made, unless given an id; several games in one
+	// process give each game's players their own (see EngineHost)
+	void SetId(int newId) { id = newId; }
+
+	virtual ~Player() { }
+
+	// This is implemented differently by each type of player and must be defined in the child class;
+	// the state is always seen from the point of view of the player making the move
 	virtual Location MakeMove(GameState) = 0;
 
+	// Called when the game is over, for players that keep working between moves
+	virtual void StopThinking() { }
+
+	// What the last call to MakeMove did, for players that search; NULL for the others
+	virtual const SearchStats * LastStats() { return NULL; }
+
 };
 
 class ComputerPlayer : public Player {
 
+	// Search state for each thread (this one first, then the helpers);
+	// kept between moves so killer moves and history scores carry over
+	std::vector<SearchContext> contexts;
+
+	// Number of threads this player's searches use, if not the process-wide ComputerPlayer::threads
+	int threadCount;
+
+	// How much of the game's time this player has used
+	TimeManager timeManager;
+
+	int depthLimit;
+	long long nodeLimit;
+
+	// Whether this player's searches use Multi-ProbCut, when its parameters are loaded
+	bool probCut;
+
+	// Whether each of this player's searches starts a new generation in the transposition table
+	bool agesTable;
+
+	SearchStats lastStats;
+
+	// Stop requests from other threads (see Stop): the stop flag of the search running in MakeMove,
+	// if there is one, and whether a stop was asked for; both guarded by stopLock
+	std::mutex stopLock;
+	std::atomic<bool> * activeStop;
+	bool stopRequested;
+
+	// Half width of the first aspiration window around the previous iteration's score; quadrupled on every failure
+	static const int ASPIRATION_WINDOW = 400;
+
+	// Pondering: the position we expect to be asked about next, if the opponent plays the reply we predicted,
+	// and the search of it that runs on ponderThread until ponderStop is set. ponderDepth and ponderMove
+	// are how far it got (see deepen)
+	std::thread ponderThread;
+	std::atomic<bool> ponderStop;
+	GameState ponderState;
+	int ponderDepth;
+	MoveVal ponderMove;
+
+	// Charges the move to the clock, prints how long it took and writes out the move's stats;
+	// MakeMove's stop flag is no longer reachable by Stop after it
+	void endMove(SearchStats &);
+
+	MoveVal deepen(GameState, SearchContext &, int, MoveVal, bool, bool, SearchStats *, int *);
+
+	// Starts pondering on the position after our move and the predicted reply, if pondering is on
+	void startPondering(GameState, Location);
+	void ponderSearch();
+
+	// Stops and joins the ponder search; returns false if there wasn't one
+	bool stopPondering();
+
 public:
 
+	// Ways of using more than one thread
+	enum ParallelMode { LAZY_SMP, YOUNG_BROTHERS_WAIT };
+
+	// Number of threads each search uses, and how they divide up the work
+	static int threads;
+	static ParallelMode parallelMode;
+
+	// Whether searches print what they did; turned off when many games are played at once
+	static bool verbose;
+
+	// Whether to keep searching on the opponent's time, on the position after the reply we expect them to play;
+	// atomic, as the protocol can turn it off while a search that is about to start pondering is running
+	static std::atomic<bool> ponder;
+
+	// With a depth limit (or a node limit), each move is searched to that depth (or for that many nodes)
+	// whatever the clock says; 0 means no limit
+	ComputerPlayer(int depthLimit = 0, long long nodeLimit = 0);
+	~ComputerPlayer();
+
 	// This is the main move function for the computer player;
 	Location MakeMove(GameState state);
 
+	// Same, for a move that was asked for at the given time; the time since then counts against the move
+	Location MakeMove(GameState state, std::chrono::steady_clock::time_point requested);
+
+	void StopThinking();
+
+	const SearchStats * LastStats() { return &lastStats; }
+
+	void UseProbCut(bool use) { probCut = use; }
+
+	// Replaces the depth and node limits given to the constructor, for the moves from now on
+	void SetLimits(int depth, long long nodes) { depthLimit = depth; nodeLimit = nodes; }
+
+	// Makes a search running in MakeMove on another thread return as soon as it can, with the best move it has.
+	// A stop that comes before the search starts ends it straight away, and so does every later one, until ClearStop
+	void Stop();
+	void ClearStop();
+
+	// Starts a new game: stops pondering and puts the whole game's time back on the clock
+	void NewGame();
+
+	// Gives this player its own time control (see TimeManager::SetControl)
+	void SetTimeControl(double moveSeconds, double gameSeconds) { timeManager.SetControl(moveSeconds, gameSeconds); }
+
+	// Seconds the next move would get in the state, or 0 if this player's moves have a depth or node limit instead
+	double MoveBudget(GameState);
+
+	// Number of threads this player's searches use; 0 goes back to ComputerPlayer::threads
+	void SetThreads(int count) { threadCount = count; }
+
+	// Turned off when many players search the shared transposition table at once, and whoever runs them
+	// advances its generations instead (see EngineHost); otherwise every move would age the others' entries
+	void SetAgesTable(bool ages) { agesTable = ages; }
+
 };
 
 class HumanPlayer : public Player {
@@ -0,0 +1,197 @@
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PositionCache.h"
+#include "Bitboard.h"
+#include "Pattern.h"
+#include "ProbCut.h"
+
+const char PositionCache::MAGIC[8] = { 'O', 'T', 'H', 'C', 'A', 'C', 'H', '2' };
+
+PositionCache::PositionCache() {
+	memory = NULL;
+	memorySize = 0;
+	buckets = NULL;
+	bucketCount = 0;
+	writable = false;
+}
+
+PositionCache::~PositionCache() {
+	Close();
+}
+
+bool PositionCache::Open(const std::string & fileName, size_t megabytes) {
+	Close();
+
+	bool canWrite = true;
+	int fd = open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		canWrite = false;
+		fd = open(fileName.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+	}
+
+	// Another process may be creating the cache too, so only whoever finds it empty under the lock sets it up.
+	// The header goes in before the file is grown, so a file cut short never passes for a cache
+	flock(fd, LOCK_EX);
+	struct stat info;
+	bool valid = fstat(fd, &info) == 0;
+	if (valid && info.st_size == 0 && canWrite) {
+		size_t maxBuckets = megabytes * 1024 * 1024 / sizeof(Bucket);
+		uint64_t count = 1;
+		while (count * 2 <= maxBuckets) {
+			count *= 2;
+		}
+		unsigned char header[HEADER_SIZE];
+		memset(header, 0, sizeof(header));
+		memcpy(header, MAGIC, sizeof(MAGIC));
+		memcpy(header + sizeof(MAGIC), &count, sizeof(count));
+		valid = pwrite(fd, header, sizeof(header), 0) == (ssize_t) sizeof(header)
+			&& ftruncate(fd, HEADER_SIZE + count * sizeof(Bucket)) == 0
+			&& fstat(fd, &info) == 0;
+	}
+	unsigned char header[HEADER_SIZE];
+	uint64_t count = 0;
+	if (valid && pread(fd, header, sizeof(header), 0) == (ssize_t) sizeof(header) && !memcmp(header, MAGIC, sizeof(MAGIC))) {
+		memcpy(&count, header + sizeof(MAGIC), sizeof(count));
+	}
+	valid = valid && count && !(count & (count - 1)) && (uint64_t) info.st_size == HEADER_SIZE + count * sizeof(Bucket);
+	flock(fd, LOCK_UN);
+
+	if (!valid) {
+		close(fd);
+		return false;
+	}
+
+	void * mapped = mmap(NULL, info.st_size, canWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+
+	// Probes go all over the file, so reading ahead would only pull in pages we don't need
+	madvise(mapped, info.st_size, MADV_RANDOM);
+
+	memory = mapped;
+	memorySize = info.st_size;
+	buckets = (Bucket *) ((char *) mapped + HEADER_SIZE);
+	bucketCount = count;
+	writable = canWrite;
+	return true;
+}
+
+void PositionCache::Close() {
+	if (memory) {
+		munmap(memory, memorySize);
+	}
+	memory = NULL;
+	memorySize = 0;
+	buckets = NULL;
+	bucketCount = 0;
+	writable = false;
+}
+
+uint64_t PositionCache::key(GameState state, Kind kind, int * symmetry) {
+	uint64_t canonical = TranspositionTable::CanonicalHash(state, symmetry);
+	if (kind == ENDGAME) {
+		return canonical ^ ENDGAME_KEY;
+	} else if (kind == PRUNED_SEARCH) {
+		return canonical ^ PRUNED_SEARCH_KEY ^ Pattern::Checksum() ^ ProbCut::Checksum();
+	}
+	return canonical ^ SEARCH_KEY ^ Pattern::Checksum();
+}
+
+uint64_t PositionCache::pack(float score, int depth, int bound, int move) {
+	uint32_t scoreBits;
+	memcpy(&scoreBits, &score, sizeof(scoreBits));
+	return (uint64_t) scoreBits
+		| (uint64_t) (uint8_t) depth << 32
+		| (uint64_t) (uint8_t) bound << 40
+		| (uint64_t) (uint8_t) move << 48;
+}
+
+bool PositionCache::Probe(GameState state, Kind kind, Entry * entry) {
+	if (!buckets) {
+		return false;
+	}
+
+	int symmetry;
+	uint64_t k = key(state, kind, &symmetry);
+	Bucket & bucket = buckets[k & (bucketCount - 1)];
+	for (int i = 0; i < ENTRIES_PER_BUCKET; ++i) {
+		uint64_t data = bucket.slots[i].data.load(std::memory_order_relaxed);
+		uint64_t check = bucket.slots[i].check.load(std::memory_order_relaxed);
+		if ((check ^ data) != k || !data) {
+			continue;
+		}
+		uint32_t scoreBits = (uint32_t) data;
+		memcpy(&entry->score, &scoreBits, sizeof(scoreBits));
+		entry->depth = (uint8_t) (data >> 32);
+		entry->bound = (TranspositionTable::Bound) (uint8_t) (data >> 40);
+		int move = (uint8_t) (data >> 48);
+
+		// Map the move back onto the actual board, dropping it if it isn't legal there
+		entry->move = TranspositionTable::NO_MOVE;
+		if (move < TranspositionTable::NO_MOVE) {
+			int s = Bitboard::TransformSquare(move, Bitboard::InverseSymmetry(symmetry));
+			if (Bitboard::Moves(state.own, state.opp) & (1ULL << s)) {
+				entry->move = s;
+			}
+		}
+		return entry->bound != TranspositionTable::NONE;
+	}
+	return false;
+}
+
+void PositionCache::Store(GameState state, Kind kind, int depth, TranspositionTable::Bound bound, double score, int move) {
+	if (!buckets || !writable) {
+		return;
+	}
+
+	int symmetry;
+	uint64_t k = key(state, kind, &symmetry);
+	if (move != TranspositionTable::NO_MOVE) {
+		move = Bitboard::TransformSquare(move, symmetry);
+	}
+	Bucket & bucket = buckets[k & (bucketCount - 1)];
+
+	// Replacement policy: the position's own slot if it is already here, unless that holds a deeper search;
+	// otherwise an empty slot, or else the shallowest entry. There is no age, as entries stay good across runs
+	Slot * replace = NULL;
+	int shallowest = INT32_MAX;
+	for (int i = 0; i < ENTRIES_PER_BUCKET; ++i) {
+		Slot & slot = bucket.slots[i];
+		uint64_t data = slot.data.load(std::memory_order_relaxed);
+		uint64_t check = slot.check.load(std::memory_order_relaxed);
+		int slotDepth = (uint8_t) (data >> 32);
+		if (data && (check ^ data) == k) {
+			if (slotDepth > depth) {
+				return;
+			}
+
+			// Keep a previously found best move if this search didn't produce one
+			if (move == TranspositionTable::NO_MOVE) {
+				move = (uint8_t) (data >> 48);
+			}
+			replace = &slot;
+			break;
+		}
+		if (!data) {
+			slotDepth = -1;
+		}
+		if (slotDepth < shallowest) {
+			shallowest = slotDepth;
+			replace = &slot;
+		}
+	}
+
+	uint64_t data = pack((float) score, depth, bound, move);
+	replace->check.store(k ^ data, std::memory_order_relaxed);
+	replace->data.store(data, std::memory_order_relaxed);
+}
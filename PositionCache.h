@@ -0,0 +1,110 @@
+#ifndef POSITIONCACHE_H
+#define POSITIONCACHE_H
+
+#include "Utils.h"
+#include "TranspositionTable.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Search results kept in a memory mapped file, so that they outlive the process: positions solved or searched
+// deeply in one game or analysis job are found again by the next one, and by any other process mapping the file.
+// It works like the transposition table, with buckets of lockless slots (the key is stored XORed with the data,
+// so a slot written by two processes at once reads as a miss rather than as the wrong position), and the kernel
+// keeps the pages of every process mapping it the same. Only nodes far enough from the leaves are cached, as a
+// lookup costs more than a transposition table probe and can touch a page that isn't in memory.
+//
+// File layout (little-endian, as the slots are used in place):
+//   8 bytes   "OTHCACH2"
+//   uint64    number of buckets (a power of two)
+//   48 bytes  reserved, so that the buckets start on a cache line
+//   buckets
+// Positions are keyed by their canonical hash (see TranspositionTable::CanonicalHash), so every rotation and
+// reflection of a position shares its entry, and moves are stored as they are on the canonical board.
+// Endgame results are exact disc differences and are kept apart from search results, which are only
+// used by searches with the same evaluation (the built in heuristic, or the same pattern weights) and the
+// same pruning (full width, or Multi-ProbCut with the same parameters and threshold)
+class PositionCache {
+
+public:
+
+	// Endgame entries are searches to the end of the game, so their depth is the number of empty squares.
+	// Pruned search entries come from searches with Multi-ProbCut on, and are only used by searches with the same parameters
+	enum Kind { SEARCH, PRUNED_SEARCH, ENDGAME };
+
+	// Unpacked entry, from the point of view of the player to move, with the move on the actual board
+	struct Entry {
+		float score;
+		int depth;
+		TranspositionTable::Bound bound;
+		int move; // Square, or TranspositionTable::NO_MOVE
+	};
+
+	// Searches with at least this much depth left, and endgame positions with at least this many empty squares, are cached
+	static const int MIN_DEPTH = 4;
+	static const int MIN_EMPTIES = 14;
+
+	// Size of a new cache file; the file is sparse, so disk space is only used as the cache fills up
+	static const size_t DEFAULT_MEGABYTES = 256;
+
+	PositionCache();
+	~PositionCache();
+
+	// Maps the cache file, creating one of the given size if there isn't one (an existing file keeps its size).
+	// A file that can't be written to is mapped read only, and nothing gets stored.
+	// Returns false (with the cache closed) if it can't be mapped or isn't a cache
+	bool Open(const std::string &, size_t megabytes = DEFAULT_MEGABYTES);
+
+	void Close();
+
+	bool IsOpen() { return buckets != NULL; }
+	bool IsWritable() { return writable; }
+	size_t Size() { return bucketCount * sizeof(Bucket); }
+
+	// Copies the entry of the kind for the state into the provided entry and returns true if there is one
+	bool Probe(GameState, Kind, Entry *);
+
+	// Stores a result for the state; score and bound are from the point of view of the player to move
+	void Store(GameState, Kind, int depth, TranspositionTable::Bound, double score, int move);
+
+private:
+
+	struct Slot {
+		std::atomic<uint64_t> check;
+		std::atomic<uint64_t> data;
+	};
+
+	static const int ENTRIES_PER_BUCKET = 4;
+
+	struct Bucket {
+		Slot slots[ENTRIES_PER_BUCKET];
+	};
+
+	static const char MAGIC[8];
+	static const size_t HEADER_SIZE = 64;
+
+	// Keep the kinds of entry apart; search entries also have the evaluation's checksum mixed in,
+	// and pruned ones the checksum of the ProbCut parameters as well
+	static const uint64_t SEARCH_KEY = 0x3c6ef372fe94f82bULL;
+	static const uint64_t PRUNED_SEARCH_KEY = 0x510e527fade682d1ULL;
+	static const uint64_t ENDGAME_KEY = 0xa54ff53a5f1d36f1ULL;
+
+	void * memory;
+	size_t memorySize;
+	Bucket * buckets;
+	size_t bucketCount;
+	bool writable;
+
+	// Canonical key of the state for the kind of entry, and the symmetry that gives it
+	static uint64_t key(GameState, Kind, int * symmetry);
+
+	static uint64_t pack(float score, int depth, int bound, int move);
+
+	PositionCache(const PositionCache &);
+	PositionCache & operator=(const PositionCache &);
+
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "ProbCut.h"
+
+double ProbCut::threshold = 1.5;
+ProbCut::Check ProbCut::table[PHASES][MAX_DEPTH + 1][MAX_CHECKS];
+int ProbCut::counts[PHASES][MAX_DEPTH + 1];
+bool ProbCut::loaded = false;
+uint64_t ProbCut::checksum = 0;
+
+// FNV-1a over the bytes of a value
+template <typename T>
+static uint64_t mix(uint64_t hash, const T & value) {
+	const unsigned char * bytes = (const unsigned char *) &value;
+	for (size_t i = 0; i < sizeof(value); ++i) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+uint64_t ProbCut::Checksum() {
+	return mix(checksum, threshold);
+}
+
+void ProbCut::Clear() {
+	for (int phase = 0; phase < PHASES; ++phase) {
+		for (int depth = 0; depth <= MAX_DEPTH; ++depth) {
+			counts[phase][depth] = 0;
+		}
+	}
+	loaded = false;
+	checksum = 0xcbf29ce484222325ULL;
+}
+
+bool ProbCut::Add(int phase, int depth, const Check & check) {
+	if (phase < 0 || phase >= PHASES || depth < MIN_DEPTH || depth > MAX_DEPTH || counts[phase][depth] == MAX_CHECKS) {
+		return false;
+	}
+	table[phase][depth][counts[phase][depth]++] = check;
+	loaded = true;
+	checksum = mix(mix(mix(mix(mix(mix(checksum, phase), depth), check.depth), check.a), check.b), check.sigma);
+	return true;
+}
+
+bool ProbCut::Load(const std::string & fileName) {
+	std::ifstream file(fileName.c_str());
+	if (!file.is_open()) {
+		return false;
+	}
+	Clear();
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream fields(line);
+		int phase, depth;
+		Check check;
+		// The shallow search has to be shallower than the one it stands in for, and has to go up with its score
+		if (!(fields >> phase >> depth >> check.depth >> check.a >> check.b >> check.sigma)
+			|| check.depth < 1 || check.depth >= depth || check.a <= 0 || check.sigma < 0 || !Add(phase, depth, check)) {
+			Clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ProbCut::Save(const std::string & fileName) {
+	std::ofstream file(fileName.c_str());
+	if (!file.is_open()) {
+		return false;
+	}
+	file << "# Multi-ProbCut parameters: phase depth shallow a b sigma" << std::endl;
+	file << "# Phases are " << PHASE_EMPTIES << " empty squares each, from 0" << std::endl;
+	for (int phase = 0; phase < PHASES; ++phase) {
+		for (int depth = 0; depth <= MAX_DEPTH; ++depth) {
+			for (int i = 0; i < counts[phase][depth]; ++i) {
+				const Check & check = table[phase][depth][i];
+				file << phase << " " << depth << " " << check.depth << " " << check.a << " " << check.b << " " << check.sigma << std::endl;
+			}
+		}
+	}
+	return file.good();
+}
+
+double ProbCut::HighBound(const Check & check, double beta, bool maxNode) {
+	double b = maxNode ? check.b : -check.b;
+	return std::ceil((beta + threshold * check.sigma - b) / check.a);
+}
+
+double ProbCut::LowBound(const Check & check, double alpha, bool maxNode) {
+	double b = maxNode ? check.b : -check.b;
+	return std::floor((alpha - threshold * check.sigma - b) / check.a);
+}
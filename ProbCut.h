@@ -0,0 +1,85 @@
+#ifndef PROBCUT_H
+#define PROBCUT_H
+
+#include <string>
+
+// Multi-ProbCut: the score of a deep search is close to a linear function of the score of a shallow
+// search of the same position, deep = a * shallow + b, give or take an error with standard deviation sigma.
+// So when a shallow search scores a node far enough outside the window (threshold sigmas, allowing for
+// the error), the deep search would almost certainly fail the same way, and the node can be cut off
+// after the shallow search alone. Each depth can have a few checks, from shallowest to deepest,
+// and the regression is fitted separately for each phase of the game, as scores swing more late on.
+//
+// The parameters come from a text file made by the calibrate tool, one check per line:
+//   phase depth shallow a b sigma
+// Lines starting with # are comments. Until a file is loaded, nothing is cut
+class ProbCut {
+
+public:
+
+	struct Check {
+		int depth; // Of the shallow search
+		double a;
+		double b;
+		double sigma;
+	};
+
+	// Phases split the game by number of empty squares, PHASE_EMPTIES at a time
+	static const int PHASES = 6;
+	static const int PHASE_EMPTIES = 10;
+
+	// Depths (of the remaining search) that checks can be given for
+	static const int MIN_DEPTH = 3;
+	static const int MAX_DEPTH = 24;
+
+	static const int MAX_CHECKS = 2;
+
+	// How many standard deviations outside the window the prediction has to be; higher cuts less, and more safely
+	static double threshold;
+
+	// Loads the parameters; returns false (with none loaded) if the file can't be read or has a bad line
+	static bool Load(const std::string &);
+
+	// Writes the parameters in the file format; returns false if the file can't be written
+	static bool Save(const std::string &);
+
+	static bool Loaded() { return loaded; }
+
+	// Changes with the parameters and the threshold, so that results of searches pruned differently can be told apart
+	static uint64_t Checksum();
+
+	// Drops every check
+	static void Clear();
+
+	// Adds a check for searches of the depth in the phase; returns false if there's no room for it
+	static bool Add(int phase, int depth, const Check &);
+
+	static int Phase(int empties) { return empties / PHASE_EMPTIES < PHASES ? empties / PHASE_EMPTIES : PHASES - 1; }
+
+	// The checks for a search of the depth with this many empty squares, and how many there are
+	static int Checks(int empties, int depth, const Check ** checks) {
+		if (depth < MIN_DEPTH || depth > MAX_DEPTH) {
+			return 0;
+		}
+		int phase = Phase(empties);
+		*checks = table[phase][depth];
+		return counts[phase][depth];
+	}
+
+	// The shallow score at or above which the deep search is predicted to reach beta,
+	// and at or below which it is predicted to stay under alpha; scores are whole numbers.
+	// The fit is from the point of view of the side to move, while the window and scores here are from the
+	// max player's, as in Game::MinimaxSearch: at min nodes that is the other side, so b changes sign
+	static double HighBound(const Check &, double beta, bool maxNode);
+	static double LowBound(const Check &, double alpha, bool maxNode);
+
+private:
+
+	static Check table[PHASES][MAX_DEPTH + 1][MAX_CHECKS];
+	static int counts[PHASES][MAX_DEPTH + 1];
+	static bool loaded;
+	static uint64_t checksum; // Of the table, kept up to date as checks are added
+
+};
+
+#endif
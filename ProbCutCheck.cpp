@@ -0,0 +1,62 @@
+/*
+ * Multi-ProbCut bound check: for a hand-built check, makes sure the shallow score bounds that
+ * Game::MinimaxSearch cuts on agree with the fitted prediction at both max and min nodes.
+ *
+ * The fit, deep = a * shallow + b, is from the point of view of the side to move, while the search
+ * window is kept from the max player's. So the prediction is worked out here the long way: turn the
+ * shallow score to the side to move's view, apply the fit, and turn the result back. Each bound has
+ * to be the loosest whole score whose prediction still clears the window by threshold sigmas.
+ *
+ * Usage: probcut-check
+ */
+
+#include <iostream>
+#include <cmath>
+
+#include "ProbCut.h"
+
+using namespace std;
+
+// What the deep search is predicted to score, from the max player's view, given the shallow score from the same view
+static double predict(const ProbCut::Check & check, double shallow, bool maxNode) {
+	double own = maxNode ? shallow : -shallow;
+	double deep = check.a * own + check.b;
+	return maxNode ? deep : -deep;
+}
+
+int main() {
+	// An offset well away from 0, so that getting its sign wrong at either node type moves the bounds
+	ProbCut::Check check;
+	check.depth = 2;
+	check.a = 0.75;
+	check.b = 1250;
+	check.sigma = 2000;
+
+	const double EPSILON = 1e-6;
+	int failures = 0;
+	for (int node = 0; node < 2; ++node) {
+		bool maxNode = node == 0;
+		for (int window = -20000; window <= 20000; window += 1250) {
+			double margin = ProbCut::threshold * check.sigma;
+
+			double high = ProbCut::HighBound(check, window, maxNode);
+			if (predict(check, high, maxNode) < window + margin - EPSILON || predict(check, high - 1, maxNode) >= window + margin - EPSILON) {
+				cout << (maxNode ? "Max" : "Min") << " node high bound for beta " << window << ": got " << high << endl;
+				++failures;
+			}
+
+			double low = ProbCut::LowBound(check, window, maxNode);
+			if (predict(check, low, maxNode) > window - margin + EPSILON || predict(check, low + 1, maxNode) <= window - margin + EPSILON) {
+				cout << (maxNode ? "Max" : "Min") << " node low bound for alpha " << window << ": got " << low << endl;
+				++failures;
+			}
+		}
+	}
+
+	if (failures) {
+		cout << failures << " bounds wrong" << endl;
+		return 1;
+	}
+	cout << "All bounds agree with the prediction" << endl;
+	return 0;
+}
@@ -0,0 +1,424 @@
+#include <atomic>
+#include <map>
+#include <cstdlib>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "Protocol.h"
+#include "Bitboard.h"
+#include "EngineHost.h"
+#include "Game.h"
+#include "Player.h"
+
+namespace {
+
+// Answers can come from search threads as well as the one reading commands
+struct Output {
+	std::ostream * stream;
+	std::mutex lock;
+};
+
+// What the engine keeps from one command to the next
+struct Session {
+	Output output;
+
+	// One player for the whole run, so that its move ordering data and pondering carry over between moves
+	ComputerPlayer player;
+
+	// The current position, seen from the side to move
+	GameState state;
+
+	// The search started by the last go, and whether it's still running
+	std::thread search;
+	std::atomic<bool> searching;
+};
+
+// The same for host mode, where the players belong to the host
+struct HostSession {
+	Output output;
+	EngineHost * host;
+
+	// The current position of every game, seen from the side to move
+	std::map<int, GameState> positions;
+};
+
+}
+
+// A go with infinite search depth is still stopped by the end of the game
+static const int INFINITE_DEPTH = 64;
+
+static void reply(Output * output, const std::string & line) {
+	std::lock_guard<std::mutex> guard(output->lock);
+	*output->stream << line << std::endl;
+}
+
+// Reads a move written like f5, or pass (which gives NO_MOVE); returns false if it's neither
+static bool parseMove(const std::string & word, int * square) {
+	if (word == "pass") {
+		*square = TranspositionTable::NO_MOVE;
+		return true;
+	}
+	if (word.size() != 2 || word[0] < 'a' || word[0] > 'h' || word[1] < '1' || word[1] > '8') {
+		return false;
+	}
+	*square = (word[1] - '1') * 8 + (word[0] - 'a');
+	return true;
+}
+
+// Plays the rest of the words as moves; returns false with a message at the first one that isn't legal
+static bool playMoves(std::istringstream & words, GameState * state, std::string * error) {
+	std::string word;
+	while (words >> word) {
+		int square;
+		if (!parseMove(word, &square)) {
+			*error = "bad move " + word;
+			return false;
+		}
+		uint64_t moves = Bitboard::Moves(state->own, state->opp);
+		if (square == TranspositionTable::NO_MOVE) {
+			if (moves || !Bitboard::Moves(state->opp, state->own)) {
+				*error = "illegal move pass";
+				return false;
+			}
+			*state = GameState::Pass(*state);
+		} else {
+			if (!(moves & (1ULL << square))) {
+				*error = "illegal move " + word;
+				return false;
+			}
+			*state = GameState::ApplyMove(*state, (1ULL << square) | Bitboard::Flips(state->own, state->opp, square));
+		}
+	}
+	return true;
+}
+
+// Reads a board of 64 squares from a1 to h8 and the side to move; returns false if either is malformed
+static bool parseBoard(const std::string & squares, const std::string & side, GameState * state) {
+	if (squares.size() != 64 || (side != "x" && side != "o")) {
+		return false;
+	}
+	uint64_t black = 0, white = 0;
+	for (int square = 0; square < 64; ++square) {
+		char c = squares[square];
+		if (c == 'x') {
+			black |= 1ULL << square;
+		} else if (c == 'o') {
+			white |= 1ULL << square;
+		} else if (c != '-') {
+			return false;
+		}
+	}
+	*state = side == "x" ? GameState(black, white) : GameState(white, black);
+	return true;
+}
+
+// Reads the rest of a position command: start or a board and side to move, then optionally moves to play on it
+static bool parsePosition(std::istringstream & words, GameState * state, std::string * error) {
+	std::string board, side, word;
+	if (!(words >> board)) {
+		*error = "missing position";
+		return false;
+	}
+	if (board == "start") {
+		*state = GameState::Start();
+	} else if (!(words >> side) || !parseBoard(board, side, state)) {
+		*error = "bad position";
+		return false;
+	}
+	if (words >> word && word != "moves") {
+		*error = "expected moves after the position";
+		return false;
+	}
+	return playMoves(words, state, error);
+}
+
+// The answer to a go, for a search that chose the square
+static std::string bestMove(int square, double score, int depth, long long nodes, double seconds) {
+	std::ostringstream line;
+	line << "bestmove " << Location::FromSquare(square).Name() << " score " << score << " depth " << depth
+		<< " nodes " << nodes << " seconds " << seconds;
+	return line.str();
+}
+
+// The answer to a go in a position where there's nothing to search, or an empty string if there is
+static std::string noMove(GameState state) {
+	if (Bitboard::Moves(state.own, state.opp)) {
+		return "";
+	}
+	return Bitboard::Moves(state.opp, state.own) ? "bestmove pass" : "bestmove none";
+}
+
+static void searchPosition(Session * session, GameState state) {
+	Location move = session->player.MakeMove(state);
+	const SearchStats * stats = session->player.LastStats();
+	std::string answer = bestMove(move.square, stats->score, stats->depth, stats->nodes, stats->seconds);
+
+	// The search is over before the answer goes out, so that whoever gets it can send the next position and go straight away
+	session->searching = false;
+	reply(&session->output, answer);
+}
+
+// Carries out one command; returns false once it's time to quit
+static bool command(Session * session, const std::string & line) {
+	std::istringstream words(line);
+	std::string name;
+	if (!(words >> name)) {
+		return true;
+	}
+
+	if (name == "quit") {
+		return false;
+	}
+	if (name == "ping") {
+		std::string token;
+		std::getline(words, token);
+		reply(&session->output, "pong" + token);
+		return true;
+	}
+	if (name == "stop") {
+		if (session->searching) {
+			session->player.Stop();
+		}
+		if (session->search.joinable()) {
+			session->search.join();
+		}
+		return true;
+	}
+	if (name == "ponder") {
+		std::string setting;
+		words >> setting;
+		if (setting != "on" && setting != "off") {
+			reply(&session->output, "error ponder must be on or off");
+			return true;
+		}
+		ComputerPlayer::ponder = setting == "on";
+		if (!ComputerPlayer::ponder && !session->searching) {
+			session->player.StopThinking();
+		}
+		return true;
+	}
+
+	// Everything else changes what a search would be working on
+	if (session->searching) {
+		reply(&session->output, "error searching");
+		return true;
+	}
+	if (session->search.joinable()) {
+		session->search.join();
+	}
+
+	if (name == "newgame") {
+		session->player.StopThinking();
+		session->player.NewGame();
+		session->state = GameState::Start();
+	} else if (name == "position") {
+		GameState state;
+		std::string error;
+		if (!parsePosition(words, &state, &error)) {
+			reply(&session->output, "error " + error);
+			return true;
+		}
+		session->player.StopThinking();
+		session->state = state;
+	} else if (name == "moves") {
+		// Pondering goes on, as these are usually our move and the reply it's hoping for
+		GameState state = session->state;
+		std::string error;
+		if (!playMoves(words, &state, &error)) {
+			reply(&session->output, "error " + error);
+			return true;
+		}
+		session->state = state;
+	} else if (name == "time") {
+		std::string kind;
+		double seconds;
+		if (!(words >> kind >> seconds) || seconds <= 0 || (kind != "move" && kind != "clock")) {
+			reply(&session->output, "error time must be move or clock and a number of seconds");
+			return true;
+		}
+		if (kind == "move") {
+			session->player.SetTimeControl(seconds, 0);
+		} else {
+			session->player.SetTimeControl(0, seconds);
+		}
+	} else if (name == "go") {
+		std::string limit;
+		int depth = 0;
+		long long nodes = 0;
+		if (words >> limit) {
+			if (limit == "infinite") {
+				depth = INFINITE_DEPTH;
+			} else if (limit == "depth") {
+				words >> depth;
+			} else if (limit == "nodes") {
+				words >> nodes;
+			}
+			if (depth <= 0 && nodes <= 0) {
+				reply(&session->output, "error go takes depth N, nodes N or infinite");
+				return true;
+			}
+		}
+
+		// Positions without a move to choose don't need a search
+		GameState state = session->state;
+		std::string answer = noMove(state);
+		if (!answer.empty()) {
+			reply(&session->output, answer);
+			return true;
+		}
+		session->player.SetLimits(depth, nodes);
+		session->player.ClearStop();
+		session->searching = true;
+		session->search = std::thread(searchPosition, session, state);
+	} else {
+		reply(&session->output, "error unknown command " + name);
+	}
+	return true;
+}
+
+int Protocol::Run(std::istream & input, std::ostream & output) {
+	// The output is for answers only
+	ComputerPlayer::verbose = false;
+
+	Session session;
+	session.output.stream = &output;
+	session.state = GameState::Start();
+	session.searching = false;
+
+	std::string line;
+	while (std::getline(input, line) && command(&session, line)) {
+	}
+
+	if (session.searching) {
+		session.player.Stop();
+	}
+	if (session.search.joinable()) {
+		session.search.join();
+	}
+	session.player.StopThinking();
+	return 0;
+}
+
+// Writes a host search's answer, tagged with its game
+struct HostAnswer {
+	Output * output;
+
+	void operator()(const EngineHost::Result & result) const {
+		std::ostringstream line;
+		line << result.game << " " << bestMove(result.square, result.score, result.depth, result.nodes, result.seconds);
+		reply(output, line.str());
+	}
+};
+
+// Carries out one host mode command; returns false once it's time to quit
+static bool hostCommand(HostSession * session, const std::string & line) {
+	std::istringstream words(line);
+	std::string first, name;
+	if (!(words >> first)) {
+		return true;
+	}
+	if (first == "quit") {
+		return false;
+	}
+	if (first == "ping") {
+		std::string token;
+		std::getline(words, token);
+		reply(&session->output, "pong" + token);
+		return true;
+	}
+
+	std::istringstream id(first);
+	int game;
+	if (!(id >> game) || !id.eof() || !(words >> name)) {
+		reply(&session->output, "error expected a game id and a command");
+		return true;
+	}
+	std::string prefix = first + " ";
+	EngineHost & host = *session->host;
+
+	if (name == "newgame") {
+		EngineHost::TimeControl control;
+		std::string kind;
+		while (words >> kind) {
+			if (kind == "move") {
+				words >> control.moveSeconds;
+				control.gameSeconds = 0;
+			} else if (kind == "clock") {
+				words >> control.gameSeconds;
+			} else if (kind == "depth") {
+				words >> control.depth;
+			} else if (kind == "nodes") {
+				words >> control.nodes;
+			} else {
+				words.setstate(std::ios::failbit);
+			}
+			if (!words) {
+				reply(&session->output, prefix + "error newgame takes move S, clock S, depth N or nodes N");
+				return true;
+			}
+		}
+		if (!host.NewGame(game, control)) {
+			reply(&session->output, prefix + "error searching");
+			return true;
+		}
+		session->positions[game] = GameState::Start();
+		return true;
+	}
+
+	std::map<int, GameState>::iterator position = session->positions.find(game);
+	if (position == session->positions.end()) {
+		reply(&session->output, prefix + "error no such game");
+		return true;
+	}
+	if (name == "stop") {
+		host.Stop(game);
+		return true;
+	}
+
+	// Everything else changes what a search would be working on
+	if (host.Busy(game)) {
+		reply(&session->output, prefix + "error searching");
+		return true;
+	}
+	if (name == "position" || name == "moves") {
+		GameState state = position->second;
+		std::string error;
+		if (name == "position" ? !parsePosition(words, &state, &error) : !playMoves(words, &state, &error)) {
+			reply(&session->output, prefix + "error " + error);
+			return true;
+		}
+		position->second = state;
+	} else if (name == "go") {
+		std::string answer = noMove(position->second);
+		if (!answer.empty()) {
+			reply(&session->output, prefix + answer);
+			return true;
+		}
+		HostAnswer callback = { &session->output };
+		host.RequestMove(game, position->second, callback);
+	} else if (name == "close") {
+		host.EndGame(game);
+		session->positions.erase(position);
+	} else {
+		reply(&session->output, prefix + "error unknown command " + name);
+	}
+	return true;
+}
+
+int Protocol::RunHost(std::istream & input, std::ostream & output, int threads) {
+	// The output is for answers only, and a pondering player would search without a thread of the pool
+	ComputerPlayer::verbose = false;
+	ComputerPlayer::ponder = false;
+
+	HostSession session;
+	session.output.stream = &output;
+	EngineHost host(threads);
+	session.host = &host;
+
+	std::string line;
+	while (std::getline(input, line) && hostCommand(&session, line)) {
+	}
+	return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <istream>
+#include <ostream>
+
+// Line based engine protocol, for driving one long running engine from another program over stdin/stdout
+// instead of starting a process per move; the transposition table, position cache and move ordering data
+// stay warm across moves and games. One command per line, words separated by spaces:
+//
+//   newgame                       Starts a game from the opening position (the engine's tables are kept)
+//   position start [moves ...]    Sets the position: the opening position, or 64 squares from a1 to h8 row
+//   position <squares> <x|o> [moves ...]   by row (- empty, x black, o white) and the side to move,
+//                                 then plays any moves given after the word moves
+//   moves <move> ...              Plays moves on the current position, written like f5, or pass
+//   time move <seconds>           Gives every search this many seconds
+//   time clock <seconds>          Sets the time left on the engine's clock for the rest of the game
+//   ponder on|off                 Whether to keep searching on the opponent's time after answering a go
+//   go [depth N | nodes N | infinite]   Searches the position for the side to move, in the background
+//   stop                          Ends a search early; it answers with the best move it has
+//   ping [token]                  Answers pong with the same token; commands are handled in order, so
+//                                 every one before it has been dealt with (a search may still be running)
+//   quit                          Stops any search and exits
+//
+// A search answers, when it's done, with
+//   bestmove <move> score <score> depth <depth> nodes <nodes> seconds <seconds>
+// where the move is like f5 (or pass if the side to move has none, or none if the game is over), and the
+// score and depth are as in SearchStats, from the point of view of the side to move. Only stop, ping, ponder
+// and quit are accepted while a search is running. Anything that can't be carried out is answered with
+//   error <message>
+// and leaves the engine as it was.
+//
+// Host mode runs any number of games at once (see EngineHost). Every command but ping and quit starts with
+// the id of the game it's for, a whole number, and so does every answer to it:
+//   <game> newgame [move <seconds> | clock <seconds> | depth N | nodes N]...   Starts (or restarts) a game
+//                                 from the opening position, with its own time control (10 seconds a move
+//                                 unless given)
+//   <game> position ..., <game> moves ...   As above
+//   <game> go                     Asks for a move; searches are scheduled by deadline on the host's threads
+//   <game> stop                   Has the game's search answered as soon as it can
+//   <game> close                  Forgets the game
+// Answers from different games come in whatever order their searches finish, and each game only
+// accepts stop while its own search is outstanding
+class Protocol {
+
+public:
+
+	// Carries out commands from the input until it ends or quit is read, answering on the output; returns the exit status
+	static int Run(std::istream &, std::ostream &);
+
+	// The same in host mode, with searches shared out over the given number of threads
+	static int RunHost(std::istream &, std::ostream &, int threads);
+
+};
+
+#endif
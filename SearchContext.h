@@ -0,0 +1,174 @@
+#ifndef SEARCHCONTEXT_H
+#define SEARCHCONTEXT_H
+
+#include "MoveOrdering.h"
+#include "Pattern.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+class SearchPool;
+
+// A node whose younger brothers are being searched by several threads at once (see SearchPool)
+class SplitPoint {
+
+public:
+
+	// Split point that the thread which created this one was working under, if any
+	SplitPoint * parent;
+
+	// Set when one of the moves causes a cutoff, so that the threads on its siblings can give up
+	std::atomic<bool> aborted;
+
+	// Guards the fields below, which are shared by every thread working on the node
+	std::mutex lock;
+
+	// The node itself and its pattern numbers (NULL if they aren't being tracked),
+	// its moves, and the order they are searched in
+	GameState state;
+	const Pattern::Features * features;
+	const MoveList * moves;
+	const int * order;
+
+	bool maxNode;
+	int depth;
+	int maxDepth;
+	double min;
+	double max;
+
+	// Best value and child index found so far, and whether a child went past the window
+	double bestVal;
+	int bestIndex;
+	bool cutoff;
+
+	// Number of children that have not been searched yet
+	std::atomic<int> pending;
+
+	// True if this node or any node above it was cut off
+	bool Aborted() {
+		for (SplitPoint * splitPoint = this; splitPoint; splitPoint = splitPoint->parent) {
+			if (splitPoint->aborted.load(std::memory_order_relaxed)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+};
+
+// Everything a single search thread carries down the tree in MinimaxSearch
+class SearchContext {
+
+public:
+
+	// Wall clock time that the search has to finish by; CPU time can't be used
+	// since it runs faster than real time when several threads are searching
+	std::chrono::steady_clock::time_point deadline;
+
+	// Shared by every thread searching the same position; set to stop them all early
+	std::atomic<bool> * stop;
+
+	// Set once the deadline has passed. The clock is only read every TIME_CHECK_INTERVAL nodes,
+	// since reading it on every node is a measurable cost
+	bool outOfTime;
+	long long nodes;
+	static const int TIME_CHECK_INTERVAL = 1024;
+
+	// The search also counts as out of time after this many nodes, if it isn't 0. The limit is on all the threads
+	// searching together: when there's more than one, they add their nodes to searchNodes TIME_CHECK_INTERVAL at a
+	// time and stop once it reaches the limit, so they can overshoot it by up to that many nodes each
+	long long nodeLimit;
+	std::atomic<long long> * searchNodes;
+
+	// For the search statistics: heuristic evaluations, nodes whose moves were searched,
+	// transposition table lookups and how many of them found the position, positions found in the persistent cache,
+	// and nodes cut off by ProbCut
+	long long leafEvaluations;
+	long long expandedNodes;
+	long long tableProbes;
+	long long tableHits;
+	long long cacheHits;
+	long long probCuts;
+
+	// Deepest ply reached in the current iteration
+	int depthTracker;
+
+	// Root moves whose searches finished in the current iteration (bit per square),
+	// so that an iteration cut short by the clock can still be used
+	uint64_t completedRootMoves;
+
+	// Killers and history for this thread
+	MoveOrderer orderer;
+
+	// Whether to cut nodes off with Multi-ProbCut, when its parameters are loaded
+	bool probCut;
+
+	// Work-stealing pool to split nodes with, if the search is running Young Brothers Wait;
+	// and the split point whose move this thread is currently searching
+	SearchPool * pool;
+	SplitPoint * splitPoint;
+
+	SearchContext() : stop(NULL), outOfTime(false), nodes(0), nodeLimit(0), searchNodes(NULL), leafEvaluations(0), expandedNodes(0), tableProbes(0), tableHits(0), cacheHits(0), probCuts(0), depthTracker(0), completedRootMoves(0), probCut(true), pool(NULL), splitPoint(NULL) { }
+
+	// Prepares for a new search that has to finish by the deadline (and within the node limit, counted in shared
+	// if the search has more than one thread)
+	void Start(std::chrono::steady_clock::time_point d, std::atomic<bool> * s, long long limit = 0, std::atomic<long long> * shared = NULL) {
+		deadline = d;
+		stop = s;
+		outOfTime = false;
+		nodes = 0;
+		nodeLimit = limit;
+		searchNodes = shared;
+		leafEvaluations = 0;
+		expandedNodes = 0;
+		tableProbes = 0;
+		tableHits = 0;
+		cacheHits = 0;
+		probCuts = 0;
+	}
+
+	// Counts a node, reading the clock (and the shared node count) every so often
+	void CountNode() {
+		++nodes;
+		if (nodeLimit && !searchNodes && nodes >= nodeLimit) {
+			runOut();
+		}
+		if ((nodes & (TIME_CHECK_INTERVAL - 1)) == 0) {
+			if (searchNodes && searchNodes->fetch_add(TIME_CHECK_INTERVAL) + TIME_CHECK_INTERVAL >= nodeLimit) {
+				runOut();
+			}
+			CheckClock();
+		}
+	}
+
+	// Reads the clock now; once this thread runs out of time the other threads searching with it are stopped too
+	bool CheckClock() {
+		if (!outOfTime && std::chrono::steady_clock::now() > deadline) {
+			runOut();
+		}
+		return TimedOut();
+	}
+
+	// True once the search should give up and return what it has
+	bool TimedOut() {
+		return outOfTime
+			|| (stop && stop->load(std::memory_order_relaxed))
+			|| (splitPoint && splitPoint->Aborted());
+	}
+
+private:
+
+	// Out of time or nodes: every thread of the search has to stop, or split points searched by other threads
+	// would hand back values from only the moves that finished, to a parent that doesn't know it's timed out
+	void runOut() {
+		outOfTime = true;
+		if (stop) {
+			stop->store(true);
+		}
+	}
+
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <chrono>
+
+#include "SearchPool.h"
+#include "Game.h"
+
+SearchPool::SearchPool(std::vector<SearchContext> & c) : contexts(c), deques(c.size()), stats(c.size()) {
+	quit = false;
+	for (unsigned int i = 0; i < contexts.size(); ++i) {
+		contexts[i].pool = this;
+		contexts[i].splitPoint = NULL;
+		stats[i].tasks = 0;
+		stats[i].steals = 0;
+		stats[i].idleSeconds = 0;
+		deques[i].front = 0;
+		deques[i].size = 0;
+	}
+	for (unsigned int i = 1; i < contexts.size(); ++i) {
+		workers.push_back(std::thread(&SearchPool::workerLoop, this, i));
+	}
+}
+
+SearchPool::~SearchPool() {
+	Stop();
+	for (unsigned int i = 0; i < contexts.size(); ++i) {
+		contexts[i].pool = NULL;
+	}
+}
+
+void SearchPool::Stop() {
+	quit = true;
+	for (unsigned int i = 0; i < workers.size(); ++i) {
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+bool SearchPool::Split(SearchContext * context, GameState state, const Pattern::Features * features, const MoveList & moves, const int * order, int first,
+		bool maxNode, int depth, int maxDepth, double min, double max, double * bestVal, int * bestIndex) {
+	SplitPoint splitPoint;
+	splitPoint.parent = context->splitPoint;
+	splitPoint.aborted = false;
+	splitPoint.state = state;
+	splitPoint.features = features;
+	splitPoint.moves = &moves;
+	splitPoint.order = order;
+	splitPoint.maxNode = maxNode;
+	splitPoint.depth = depth;
+	splitPoint.maxDepth = maxDepth;
+	splitPoint.min = min;
+	splitPoint.max = max;
+	splitPoint.bestVal = *bestVal;
+	splitPoint.bestIndex = -1;
+	splitPoint.cutoff = false;
+	splitPoint.pending = moves.count - first;
+
+	// Push in reverse so that the best ordered move is on the back, where this thread takes work from
+	int thread = threadIndex(context);
+	bool queued;
+	{
+		Deque & deque = deques[thread];
+		std::lock_guard<std::mutex> guard(deque.lock);
+		queued = deque.size + moves.count - first <= Deque::CAPACITY;
+		for (int n = moves.count - 1; queued && n >= first; --n) {
+			Task task = { &splitPoint, n };
+			deque.tasks[(deque.front + deque.size++) % Deque::CAPACITY] = task;
+		}
+	}
+
+	// If the deque is full, just search the moves on this thread
+	for (int n = first; !queued && n < moves.count; ++n) {
+		Task task = { &splitPoint, n };
+		runTask(thread, task);
+	}
+
+	// Help out until every move has been searched; the split point lives on this stack frame,
+	// so we can't return while anyone could still be using it
+	std::chrono::steady_clock::time_point idleStart;
+	bool idle = false;
+	while (splitPoint.pending.load() > 0) {
+		Task task;
+		if (getTask(thread, &task)) {
+			if (idle) {
+				stats[thread].idleSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - idleStart).count();
+				idle = false;
+			}
+			runTask(thread, task);
+		} else {
+			if (!idle) {
+				idleStart = std::chrono::steady_clock::now();
+				idle = true;
+			}
+			std::this_thread::yield();
+		}
+	}
+	if (idle) {
+		stats[thread].idleSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - idleStart).count();
+	}
+
+	*bestVal = splitPoint.bestVal;
+	*bestIndex = splitPoint.bestIndex;
+	return splitPoint.cutoff;
+}
+
+std::vector<SearchPool::ThreadStats> SearchPool::GetStats() {
+	return stats;
+}
+
+bool SearchPool::getTask(int thread, Task * task) {
+	{
+		Deque & own = deques[thread];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (own.size) {
+			*task = own.tasks[(own.front + --own.size) % Deque::CAPACITY];
+			return true;
+		}
+	}
+
+	int threads = deques.size();
+	for (int i = 1; i < threads; ++i) {
+		Deque & victim = deques[(thread + i) % threads];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (victim.size) {
+			*task = victim.tasks[victim.front];
+			victim.front = (victim.front + 1) % Deque::CAPACITY;
+			--victim.size;
+			++stats[thread].steals;
+			return true;
+		}
+	}
+	return false;
+}
+
+void SearchPool::runTask(int thread, Task task) {
+	SearchContext * context = &contexts[thread];
+	SplitPoint * splitPoint = task.splitPoint;
+	++stats[thread].tasks;
+
+	// Search under the split point so that a cutoff by a sibling stops this search too
+	SplitPoint * previous = context->splitPoint;
+	context->splitPoint = splitPoint;
+
+	if (!context->TimedOut()) {
+		// Use the window as it stands now, since other moves may have tightened it
+		double min, max;
+		{
+			std::lock_guard<std::mutex> guard(splitPoint->lock);
+			min = splitPoint->maxNode ? std::max(splitPoint->min, splitPoint->bestVal) : splitPoint->min;
+			max = splitPoint->maxNode ? splitPoint->max : std::min(splitPoint->max, splitPoint->bestVal);
+		}
+
+		int index = splitPoint->order[task.moveNumber];
+		int square = splitPoint->moves->squares[index];
+		uint64_t changed = splitPoint->moves->changed[index];
+		GameState child = splitPoint->state;
+		child.Make(changed);
+		Pattern::Features childFeatures;
+		const Pattern::Features * features = NULL;
+		if (splitPoint->features) {
+			Pattern::Play(*splitPoint->features, square, changed, splitPoint->maxNode, &childFeatures);
+			features = &childFeatures;
+		}
+
+		// Younger brothers get a null window search first, as in Game::MinimaxSearch
+		int depth = splitPoint->depth + 1;
+		MoveVal move;
+		if (splitPoint->maxNode) {
+			move = Game::MinimaxSearch(child, min, min + 1, depth, splitPoint->maxDepth, context, features);
+		} else {
+			move = Game::MinimaxSearch(child, max - 1, max, depth, splitPoint->maxDepth, context, features);
+		}
+		if (move.value > min && move.value < max && !context->TimedOut()) {
+			move = Game::MinimaxSearch(child, min, max, depth, splitPoint->maxDepth, context, features);
+		}
+
+		// Results from an aborted search are incomplete, so only merge finished ones
+		if (!context->TimedOut()) {
+			std::lock_guard<std::mutex> guard(splitPoint->lock);
+			if (splitPoint->maxNode) {
+				if (move.value > splitPoint->bestVal) {
+					splitPoint->bestVal = move.value;
+					splitPoint->bestIndex = index;
+				}
+				splitPoint->cutoff = splitPoint->bestVal >= splitPoint->max;
+			} else {
+				if (move.value < splitPoint->bestVal) {
+					splitPoint->bestVal = move.value;
+					splitPoint->bestIndex = index;
+				}
+				splitPoint->cutoff = splitPoint->bestVal <= splitPoint->min;
+			}
+			if (splitPoint->cutoff) {
+				splitPoint->aborted = true;
+				context->orderer.RecordCutoff(square, splitPoint->depth, splitPoint->maxDepth - splitPoint->depth, task.moveNumber);
+			}
+		}
+	}
+
+	context->splitPoint = previous;
+	splitPoint->pending.fetch_sub(1);
+}
+
+void SearchPool::workerLoop(int thread) {
+	std::chrono::steady_clock::time_point idleStart = std::chrono::steady_clock::now();
+	while (!quit.load()) {
+		Task task;
+		if (getTask(thread, &task)) {
+			stats[thread].idleSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - idleStart).count();
+			runTask(thread, task);
+			idleStart = std::chrono::steady_clock::now();
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	stats[thread].idleSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - idleStart).count();
+}
@@ -0,0 +1,83 @@
+#ifndef SEARCHPOOL_H
+#define SEARCHPOOL_H
+
+#include "SearchContext.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Young Brothers Wait parallel search: once a node's first move has been searched without a cutoff,
+// its remaining moves are pushed onto the owning thread's deque, where idle threads can steal them.
+// Owners pop their own deque from the back, and thieves take from the front of someone else's,
+// so stolen work tends to be the largest subtrees
+class SearchPool {
+
+public:
+
+	// Nodes closer to the leaves than this are not worth the cost of splitting
+	static const int MIN_SPLIT_DEPTH = 3;
+
+	// How much each thread did during the search
+	struct ThreadStats {
+		long long tasks; // Moves searched on behalf of a split point
+		long long steals; // Of those, how many were taken from another thread's deque
+		double idleSeconds; // Time spent waiting for work
+	};
+
+	// Starts a worker for every context after the first, which belongs to the calling thread
+	SearchPool(std::vector<SearchContext> &);
+
+	~SearchPool();
+
+	// Stops and joins the workers; should be called before reading the stats
+	void Stop();
+
+	bool ShouldSplit(int remainingDepth, int moves) { return remainingDepth >= MIN_SPLIT_DEPTH && moves > 1; }
+
+	// Searches moves[order[first]] onwards in parallel and merges the results into bestVal;
+	// sets bestIndex to the move that improved bestVal last (if any) and returns true if a move caused a cutoff
+	bool Split(SearchContext *, GameState, const Pattern::Features *, const MoveList &, const int *, int, bool, int, int, double, double, double *, int *);
+
+	std::vector<ThreadStats> GetStats();
+
+private:
+
+	struct Task {
+		SplitPoint * splitPoint;
+		int moveNumber; // Position of the move in the split point's order
+	};
+
+	// A fixed ring buffer, so that splitting never allocates; it holds a full move list for every ply,
+	// which is more than a thread's nested split points ever have outstanding in practice
+	struct Deque {
+		static const int CAPACITY = MoveOrderer::MAX_PLY * MoveList::MAX_MOVES;
+		std::mutex lock;
+		Task tasks[CAPACITY];
+		int front; // Index of the first task
+		int size;
+	};
+
+	std::vector<SearchContext> & contexts;
+	std::vector<Deque> deques;
+	std::vector<ThreadStats> stats;
+	std::vector<std::thread> workers;
+	std::atomic<bool> quit;
+
+	// Takes work from the back of the thread's own deque, or else from the front of another's
+	bool getTask(int, Task *);
+
+	void runTask(int, Task);
+
+	void workerLoop(int);
+
+	// Index of the context in contexts, which is also the thread's deque
+	int threadIndex(SearchContext * context) { return context - &contexts[0]; }
+
+	SearchPool(const SearchPool &);
+	SearchPool & operator=(const SearchPool &);
+
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+#include "SearchStats.h"
+#include "Utils.h"
+
+std::ostream * SearchStats::sink = NULL;
+std::ofstream SearchStats::file;
+std::mutex SearchStats::lock;
+
+SearchStats::SearchStats() {
+	player = 0;
+	empties = 0;
+	source = SEARCH;
+	move = 0;
+	score = 0;
+	depth = 0;
+	seconds = 0;
+	ponderHit = false;
+	nodes = 0;
+	leafEvaluations = 0;
+	expandedNodes = 0;
+	tableProbes = 0;
+	tableHits = 0;
+	cacheHits = 0;
+	probCuts = 0;
+	cutoffs = 0;
+	firstMoveCutoffs = 0;
+}
+
+double SearchStats::BranchingFactor() const {
+	const Iteration * last = NULL;
+	const Iteration * previous = NULL;
+	for (unsigned int i = 0; i < iterations.size(); ++i) {
+		if (iterations[i].completed) {
+			previous = last;
+			last = &iterations[i];
+		}
+	}
+	return previous && previous->nodes ? (double) last->nodes / previous->nodes : 0;
+}
+
+// JSON has no infinities, which a search stopped before its first move finished can leave behind
+static std::string number(double value) {
+	if (!std::isfinite(value)) {
+		return "null";
+	}
+	std::ostringstream out;
+	out << value;
+	return out.str();
+}
+
+static double rate(long long part, long long whole) {
+	return whole ? (double) part / whole : 0;
+}
+
+std::string SearchStats::ToJson() const {
+	static const char * sourceNames[] = { "search", "book", "endgame" };
+
+	std::ostringstream out;
+	out << "{\"player\": " << player << ", \"empties\": " << empties << ", \"source\": \"" << sourceNames[source] << "\""
+		<< ", \"move\": \"" << Location::FromSquare(move).Name() << "\", \"score\": " << number(score) << ", \"depth\": " << depth
+		<< ", \"seconds\": " << number(seconds) << ", \"ponder_hit\": " << (ponderHit ? "true" : "false")
+		<< ", \"nodes\": " << nodes << ", \"leaf_evaluations\": " << leafEvaluations
+		<< ", \"nodes_per_second\": " << (long long) (seconds > 0 ? nodes / seconds : 0)
+		<< ", \"branching_factor\": " << number(BranchingFactor())
+		<< ", \"cutoff_rate\": " << number(rate(cutoffs, expandedNodes))
+		<< ", \"first_move_cutoff_rate\": " << number(rate(firstMoveCutoffs, cutoffs))
+		<< ", \"table_probes\": " << tableProbes << ", \"table_hit_rate\": " << number(rate(tableHits, tableProbes))
+		<< ", \"cache_hits\": " << cacheHits << ", \"probcuts\": " << probCuts
+		<< ", \"iterations\": [";
+	for (unsigned int i = 0; i < iterations.size(); ++i) {
+		const Iteration & iteration = iterations[i];
+		out << (i ? ", " : "") << "{\"depth\": " << iteration.depth << ", \"seconds\": " << number(iteration.seconds)
+			<< ", \"nodes\": " << iteration.nodes << ", \"completed\": " << (iteration.completed ? "true" : "false") << "}";
+	}
+	out << "], \"pv\": [";
+	for (unsigned int i = 0; i < principalVariation.size(); ++i) {
+		out << (i ? ", " : "") << "\"" << Location::FromSquare(principalVariation[i]).Name() << "\"";
+	}
+	out << "]}";
+	return out.str();
+}
+
+bool SearchStats::Open(const std::string & fileName) {
+	std::lock_guard<std::mutex> guard(lock);
+	if (fileName == "-") {
+		sink = &std::cout;
+		return true;
+	}
+	file.open(fileName.c_str(), std::ios::app);
+	sink = file.is_open() ? &file : NULL;
+	return sink != NULL;
+}
+
+void SearchStats::Write(const SearchStats & stats) {
+	if (!sink) {
+		return;
+	}
+	std::string line = stats.ToJson();
+	std::lock_guard<std::mutex> guard(lock);
+	*sink << line << std::endl;
+}
@@ -0,0 +1,76 @@
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// What a computer player did to choose one move. Every move's record is written as a line of JSON
+// to the stats sink, if one has been opened, so that slow moves can be looked into after the fact
+class SearchStats {
+
+public:
+
+	// How the move was chosen
+	enum Source { SEARCH, BOOK, ENDGAME };
+
+	// One iteration of iterative deepening on the searching thread (helpers aren't broken down)
+	struct Iteration {
+		int depth;
+		double seconds;
+		long long nodes;
+		bool completed; // False if it was cut short by the clock
+	};
+
+	int player;
+	int empties;
+	Source source;
+	int move; // Square
+	double score; // From the mover's point of view; the final disc difference (or 1, 0, -1) for the endgame solver
+	int depth; // Deepest finished iteration, or the number of empty squares for a solved endgame
+	double seconds;
+	bool ponderHit;
+
+	// Totals over every thread
+	long long nodes;
+	long long leafEvaluations;
+	long long expandedNodes; // Nodes whose moves were searched
+	long long tableProbes;
+	long long tableHits;
+	long long cacheHits;
+	long long probCuts;
+	long long cutoffs;
+	long long firstMoveCutoffs;
+
+	std::vector<Iteration> iterations;
+
+	// Expected line of play, starting with the move, as squares
+	std::vector<int> principalVariation;
+
+	SearchStats();
+
+	// Ratio of the nodes in the last finished iteration to the one before it, or 0 if there weren't two
+	double BranchingFactor() const;
+
+	std::string ToJson() const;
+
+	// Sends the records to the end of the file, or to stdout if the name is "-";
+	// returns false if the file can't be opened
+	static bool Open(const std::string &);
+
+	static bool IsOpen() { return sink != NULL; }
+
+	// Writes the record as a single line if the sink is open; can be called from several threads at once
+	static void Write(const SearchStats &);
+
+private:
+
+	static std::ostream * sink;
+	static std::ofstream file;
+	static std::mutex lock;
+
+};
+
+#endif
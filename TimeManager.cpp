@@ -0,0 +1,71 @@
+#include <algorithm>
+
+#include "TimeManager.h"
+#include "Game.h"
+#include "Endgame.h"
+
+double TimeManager::gameTime = 0;
+const double TimeManager::SAFETY_SECONDS = 0.05;
+
+TimeManager::TimeManager() : ownControl(false), moveSeconds(0), gameSeconds(0) {
+	remaining = gameTime;
+}
+
+void TimeManager::SetControl(double move, double game) {
+	ownControl = true;
+	moveSeconds = move;
+	gameSeconds = game;
+	remaining = game;
+}
+
+double TimeManager::moveTime() {
+	return ownControl ? moveSeconds : Game::timeLimit;
+}
+
+double TimeManager::Budget(int empties) {
+	if (clockTime() <= 0) {
+		return moveTime();
+	}
+
+	// We make about half of the remaining moves
+	double available = std::max(0.01, remaining - SAFETY_SECONDS);
+	int moves = std::max(1, (empties + 1) / 2);
+
+	// Spend less in the opening, where positions are well known and the book often answers, and more in the midgame,
+	// where depth matters most. The first endgame solve is the hardest move of the game, and everything after it is quick
+	double weight;
+	if (empties > 44) {
+		weight = 0.5;
+	} else if (empties > std::max(Endgame::exactEmpties, Endgame::wldEmpties)) {
+		weight = 1.2;
+	} else {
+		weight = 3;
+	}
+	return std::min(available * weight / moves, available / 2);
+}
+
+void TimeManager::StartMove(int empties, std::chrono::steady_clock::time_point moveStart) {
+	start = moveStart;
+	double target = Budget(empties);
+
+	if (clockTime() <= 0) {
+		// Nothing is saved by stopping early when the time can't be used later
+		hardDeadline = softDeadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(target));
+		return;
+	}
+
+	// Another iteration takes several times as long as the last one, so don't start one past half the target.
+	// An iteration that is already running can use the rest, since even an unfinished one is worth something
+	softDeadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(target / 2));
+	hardDeadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(target));
+}
+
+void TimeManager::EndMove() {
+	if (clockTime() > 0) {
+		remaining -= Elapsed();
+	}
+}
+
+double TimeManager::Elapsed() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,66 @@
+#ifndef TIMEMANAGER_H
+#define TIMEMANAGER_H
+
+#include <chrono>
+
+// Decides how long each move may take. With a per-move limit (the default) every move gets the same time;
+// with a clock for the whole game, each move gets a share of what is left, weighted by the phase of the game.
+// Unless it is given a time control of its own, it follows the process-wide Game::timeLimit and gameTime
+class TimeManager {
+
+public:
+
+	// Thinking time for each computer player's whole game, in seconds; 0 means every move gets Game::timeLimit
+	static double gameTime;
+
+	TimeManager();
+
+	// Gives this time manager its own control: moveSeconds for every move, or gameSeconds for the whole game
+	// if that is above 0, in which case the clock starts full
+	void SetControl(double moveSeconds, double gameSeconds);
+
+	// Puts the whole game's time back on the clock
+	void Reset() { remaining = clockTime(); }
+
+	// Whether moves share a clock for the whole game, rather than each getting the same time
+	bool UsesClock() { return clockTime() > 0; }
+
+	// Seconds a move with the given number of empty squares gets, up to its hard deadline
+	double Budget(int empties);
+
+	// Starts timing a move with the given number of empty squares and works out its deadlines. The move's time
+	// runs from start, which is before now if the move had to wait for a thread to search it
+	void StartMove(int empties, std::chrono::steady_clock::time_point moveStart = std::chrono::steady_clock::now());
+
+	// Charges the time taken since the move's start to the game clock
+	void EndMove();
+
+	// No new iteration is started after the soft deadline, and the search is stopped wherever it is at the hard one
+	std::chrono::steady_clock::time_point SoftDeadline() { return softDeadline; }
+	std::chrono::steady_clock::time_point HardDeadline() { return hardDeadline; }
+
+	// Seconds since the move's start, and seconds left on the game clock
+	double Elapsed();
+	double Remaining() { return remaining; }
+
+private:
+
+	// Kept back from every allocation to cover the time spent outside the search
+	static const double SAFETY_SECONDS;
+
+	// This time manager's own control, if it has one (see SetControl)
+	bool ownControl;
+	double moveSeconds;
+	double gameSeconds;
+
+	double moveTime();
+	double clockTime() { return ownControl ? gameSeconds : gameTime; }
+
+	double remaining;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point softDeadline;
+	std::chrono::steady_clock::time_point hardDeadline;
+
+};
+
+#endif
@@ -0,0 +1,342 @@
+/*
+ * Headless self-play: plays many computer vs computer games at once across a pool of threads,
+ * each opening twice so that both engines get to play both sides of it, and reports the results
+ * for engine 1 with 95% confidence intervals.
+ *
+ * Each engine searches every move to a fixed depth or for a fixed number of nodes, so a slower or busier
+ * machine doesn't make either engine play worse. Runs still aren't exactly reproducible: all games share
+ * the transposition table, and what an engine finds there depends on how the threads playing the other
+ * games happened to be scheduled. Playing more games averages this out like any other noise.
+ *
+ * Usage: tournament [--openings file | --random-openings plies] [--games count] [--threads count]
+ *                   [--depth1 plies] [--nodes1 count] [--depth2 plies] [--nodes2 count]
+ *                   [--probcut file] [--probcut-threshold sigmas] [--no-probcut1] [--no-probcut2]
+ *                   [--hash megabytes] [--exact empties] [--wld empties] [--weights file] [--book file]
+ *                   [--stats file] [--record file] [--cache file]
+ * The openings file has one opening per line, written as moves like f5d6c3. With --record, every game
+ * is added to the game archive, with engine 1 as player 1. With --cache, both engines share the
+ * persistent position cache, so results that an earlier run left in it make their searches shallower.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Game.h"
+#include "Player.h"
+#include "Bitboard.h"
+#include "Endgame.h"
+#include "Pattern.h"
+#include "OpeningBook.h"
+#include "SearchStats.h"
+#include "GameArchive.h"
+#include "ProbCut.h"
+
+using namespace std;
+
+// How an engine limits each search, and whether it prunes with ProbCut (when parameters are loaded)
+struct Engine {
+	int depth;
+	long long nodes;
+	bool probCut;
+};
+
+struct Results {
+	mutex lock;
+	int games;
+	int wins, losses, draws; // For engine 1
+	double discSum, discSquares; // Engine 1's final disc difference
+	int illegal; // Games ended by an illegal move (counted as a loss for the side that made it)
+};
+
+static ostream & operator<<(ostream & out, const Engine & engine) {
+	if (engine.nodes) {
+		out << engine.nodes << " nodes";
+	} else {
+		out << "depth " << engine.depth;
+	}
+	if (engine.probCut && ProbCut::Loaded()) {
+		out << ", ProbCut";
+	}
+	return out;
+}
+
+// Plays out a game from the opening; returns engine 1's final disc difference, with empty squares going to the winner
+static int playGame(GameState state, bool engine1First, const Engine engines[2], bool * illegal) {
+	ComputerPlayer first(engines[0].depth, engines[0].nodes);
+	ComputerPlayer second(engines[1].depth, engines[1].nodes);
+	ComputerPlayer * players[2] = { &first, &second };
+	first.UseProbCut(engines[0].probCut);
+	second.UseProbCut(engines[1].probCut);
+
+	GameArchive::Record record;
+	record.start = state;
+	record.firstPlayer = engine1First ? 1 : 2;
+
+	// The state is seen from the side to move, so track which engine that is
+	int toMove = engine1First ? 0 : 1;
+	bool passed = false;
+	*illegal = false;
+	while (true) {
+		uint64_t moves = Bitboard::Moves(state.own, state.opp);
+		if (!moves) {
+			if (passed) {
+				break;
+			}
+			passed = true;
+			state = GameState::Pass(state);
+			toMove ^= 1;
+			continue;
+		}
+		passed = false;
+
+		Location move = players[toMove]->MakeMove(state);
+		if (move.square > 63 || !(moves & (1ULL << move.square))) {
+			cout << "Engine " << toMove + 1 << " played an illegal move " << move << endl;
+			*illegal = true;
+			return toMove == 0 ? -64 : 64;
+		}
+		record.AddMove(move.square, players[toMove]->LastStats());
+		state = GameState::ApplyMove(state, Game::GetChangedPieces(state, move));
+		toMove ^= 1;
+	}
+
+	int own = Bitboard::Count(state.own), opp = Bitboard::Count(state.opp);
+	int empties = 64 - own - opp;
+	int difference = own - opp + (own > opp ? empties : (own < opp ? -empties : 0));
+	difference = toMove == 0 ? difference : -difference;
+	if (Game::archive.IsOpen()) {
+		record.result = engine1First ? difference : -difference;
+		if (!Game::archive.Append(record)) {
+			cout << "Could not add a game to the archive" << endl;
+		}
+	}
+	return difference;
+}
+
+static void worker(const vector<GameState> * openings, int totalGames, const Engine * engines, atomic<int> * next, Results * results) {
+	while (true) {
+		int game = next->fetch_add(1);
+		if (game >= totalGames) {
+			return;
+		}
+
+		// Consecutive games play the same opening with the engines swapped
+		bool illegal;
+		int difference = playGame((*openings)[(game / 2) % openings->size()], game % 2 == 0, engines, &illegal);
+
+		lock_guard<mutex> guard(results->lock);
+		++results->games;
+		if (difference > 0) {
+			++results->wins;
+		} else if (difference < 0) {
+			++results->losses;
+		} else {
+			++results->draws;
+		}
+		results->discSum += difference;
+		results->discSquares += (double) difference * difference;
+		if (illegal) {
+			++results->illegal;
+		}
+		if (results->games % 100 == 0 || results->games == totalGames) {
+			cout << results->games << "/" << totalGames << " games: +" << results->wins << " -" << results->losses << " =" << results->draws << endl;
+		}
+	}
+}
+
+// Replays each line of the file from the start position; lines with an illegal move are skipped
+static bool readOpenings(const string & fileName, vector<GameState> * openings) {
+	ifstream file(fileName.c_str());
+	if (!file.is_open()) {
+		return false;
+	}
+	string line;
+	while (getline(file, line)) {
+		vector<int> moves = OpeningBook::ParseMoves(line);
+		GameState state = GameState::Start();
+		bool valid = true;
+		for (unsigned int i = 0; i < moves.size() && valid; ++i) {
+			if (!Bitboard::Moves(state.own, state.opp)) {
+				state = GameState::Pass(state);
+			}
+			uint64_t changed = (1ULL << moves[i]) | Bitboard::Flips(state.own, state.opp, moves[i]);
+			valid = (Bitboard::Moves(state.own, state.opp) & (1ULL << moves[i])) != 0;
+			state = GameState::ApplyMove(state, changed);
+		}
+		if (valid && Bitboard::Moves(state.own, state.opp)) {
+			openings->push_back(state);
+		}
+	}
+	return true;
+}
+
+// Openings made of random moves from the start position, always the same for the same count
+static vector<GameState> randomOpenings(int count, int plies) {
+	srand(1);
+	vector<GameState> openings;
+	while ((int) openings.size() < count) {
+		GameState state = GameState::Start();
+		for (int ply = 0; ply < plies; ++ply) {
+			uint64_t moves = Bitboard::Moves(state.own, state.opp);
+			if (!moves) {
+				break;
+			}
+			for (int skip = rand() % Bitboard::Count(moves); skip; --skip) {
+				moves &= moves - 1;
+			}
+			int square = Bitboard::FirstSquare(moves);
+			state = GameState::ApplyMove(state, (1ULL << square) | Bitboard::Flips(state.own, state.opp, square));
+		}
+		if (Bitboard::Moves(state.own, state.opp)) {
+			openings.push_back(state);
+		}
+	}
+	return openings;
+}
+
+// Elo difference that a score (fraction of points won) corresponds to
+static double elo(double score) {
+	score = max(1e-6, min(1 - 1e-6, score));
+	return -400 * log10(1 / score - 1);
+}
+
+int main(int argc, char * argv[]) {
+	string openingsFile;
+	int randomPlies = 8;
+	int games = 0;
+	int threads = max(1u, thread::hardware_concurrency());
+	Engine engines[2] = { { 0, 0, true }, { 0, 0, true } };
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--openings") && i + 1 < argc) {
+			openingsFile = argv[++i];
+		} else if (!strcmp(argv[i], "--random-openings") && i + 1 < argc) {
+			randomPlies = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--games") && i + 1 < argc) {
+			games = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			threads = max(1, atoi(argv[++i]));
+		} else if ((!strcmp(argv[i], "--depth1") || !strcmp(argv[i], "--depth2")) && i + 1 < argc) {
+			engines[argv[i][7] - '1'].depth = atoi(argv[i + 1]);
+			++i;
+		} else if ((!strcmp(argv[i], "--nodes1") || !strcmp(argv[i], "--nodes2")) && i + 1 < argc) {
+			engines[argv[i][7] - '1'].nodes = atoll(argv[i + 1]);
+			++i;
+		} else if (!strcmp(argv[i], "--no-probcut1") || !strcmp(argv[i], "--no-probcut2")) {
+			engines[argv[i][12] - '1'].probCut = false;
+		} else if (!strcmp(argv[i], "--probcut") && i + 1 < argc) {
+			if (!ProbCut::Load(argv[++i])) {
+				cout << "Could not load ProbCut parameters from " << argv[i] << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--probcut-threshold") && i + 1 < argc) {
+			ProbCut::threshold = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+			Game::transpositionTable.Resize(atoi(argv[++i]));
+		} else if (!strcmp(argv[i], "--exact") && i + 1 < argc) {
+			Endgame::exactEmpties = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--wld") && i + 1 < argc) {
+			Endgame::wldEmpties = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--weights") && i + 1 < argc) {
+			if (!Pattern::Load(argv[++i])) {
+				cout << "Could not load pattern weights from " << argv[i] << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+			if (!SearchStats::Open(argv[++i])) {
+				cout << "Could not open " << argv[i] << " for the search statistics" << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+			if (!Game::archive.Open(argv[++i])) {
+				cout << "Could not open game archive " << argv[i] << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--book") && i + 1 < argc) {
+			if (!Game::openingBook.Open(argv[++i])) {
+				cout << "Could not open opening book " << argv[i] << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--cache") && i + 1 < argc) {
+			if (!Game::positionCache.Open(argv[++i])) {
+				cout << "Could not open position cache " << argv[i] << endl;
+				return 1;
+			}
+		} else {
+			cout << "Usage: " << argv[0] << " [--openings file | --random-openings plies] [--games count] [--threads count]"
+				<< " [--depth1 plies] [--nodes1 count] [--depth2 plies] [--nodes2 count]"
+				<< " [--probcut file] [--probcut-threshold sigmas] [--no-probcut1] [--no-probcut2]"
+				<< " [--hash megabytes] [--exact empties] [--wld empties] [--weights file] [--book file] [--stats file] [--record file] [--cache file]" << endl;
+			return 1;
+		}
+	}
+	for (int e = 0; e < 2; ++e) {
+		if (!engines[e].depth && !engines[e].nodes) {
+			engines[e].depth = 4;
+		}
+	}
+
+	// Parallelism comes from playing many games at once, so each search stays on one thread and keeps quiet
+	ComputerPlayer::threads = 1;
+	ComputerPlayer::verbose = false;
+
+	vector<GameState> openings;
+	if (!openingsFile.empty()) {
+		if (!readOpenings(openingsFile, &openings) || openings.empty()) {
+			cout << "No usable openings in " << openingsFile << endl;
+			return 1;
+		}
+		if (!games) {
+			games = 2 * openings.size();
+		}
+	} else {
+		if (!games) {
+			games = 100;
+		}
+		openings = randomOpenings((games + 1) / 2, randomPlies);
+	}
+
+	cout << "Engine 1 (" << engines[0] << ") vs engine 2 (" << engines[1] << "): " << games << " games from "
+		<< openings.size() << " openings on " << threads << " threads" << endl;
+
+	Results results;
+	results.games = results.wins = results.losses = results.draws = results.illegal = 0;
+	results.discSum = results.discSquares = 0;
+	atomic<int> next(0);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<thread> pool;
+	for (int t = 0; t < threads; ++t) {
+		pool.push_back(thread(worker, &openings, games, engines, &next, &results));
+	}
+	for (unsigned int t = 0; t < pool.size(); ++t) {
+		pool[t].join();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// Score with a normal approximation of its 95% confidence interval, from the spread of the per-game scores
+	int n = results.games;
+	double score = (results.wins + 0.5 * results.draws) / n;
+	double variance = (results.wins * (1 - score) * (1 - score) + results.losses * score * score
+		+ results.draws * (0.5 - score) * (0.5 - score)) / n;
+	double scoreMargin = 1.96 * sqrt(variance / n);
+	double discMean = results.discSum / n;
+	double discMargin = 1.96 * sqrt(max(0.0, results.discSquares / n - discMean * discMean) / n);
+
+	cout << endl << "Engine 1: " << results.wins << " wins, " << results.losses << " losses, " << results.draws << " draws" << endl;
+	cout << "Score: " << 100 * score << "% +/- " << 100 * scoreMargin << "%" << endl;
+	cout << "Elo difference: " << elo(score) << " (" << elo(score - scoreMargin) << " to " << elo(score + scoreMargin) << ")" << endl;
+	cout << "Disc difference: " << discMean << " +/- " << discMargin << endl;
+	if (results.illegal) {
+		cout << results.illegal << " games ended with an illegal move" << endl;
+	}
+	cout << "Took " << seconds << " seconds (" << n / seconds << " games/sec)" << endl;
+	return 0;
+}
@@ -0,0 +1,193 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "TranspositionTable.h"
+#include "Bitboard.h"
+
+uint64_t TranspositionTable::zobrist[16][256];
+
+// Fill in the Zobrist keys before main runs
+bool TranspositionTable::zobristInitialized = (TranspositionTable::initZobrist(), true);
+
+void TranspositionTable::initZobrist() {
+	// SplitMix64 with a fixed seed so hashes are the same on every run
+	uint64_t seed = 0x9e3779b97f4a7c15ULL;
+	for (int i = 0; i < 16; ++i) {
+		for (int j = 0; j < 256; ++j) {
+			uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			zobrist[i][j] = z ^ (z >> 31);
+		}
+	}
+}
+
+uint64_t TranspositionTable::Hash(GameState state) {
+	uint64_t hash = 0;
+	for (int i = 0; i < 8; ++i) {
+		hash ^= zobrist[i][(state.own >> (8 * i)) & 0xff];
+		hash ^= zobrist[8 + i][(state.opp >> (8 * i)) & 0xff];
+	}
+	return hash;
+}
+
+uint64_t TranspositionTable::CanonicalHash(GameState state, int * symmetry) {
+	return Hash(GameState::Canonical(state, symmetry));
+}
+
+uint64_t TranspositionTable::Key(GameState state, bool pruned, int * symmetry) {
+	uint64_t key;
+	if (64 - Bitboard::Count(state.own | state.opp) >= CANONICAL_EMPTIES) {
+		key = CanonicalHash(state, symmetry);
+	} else {
+		*symmetry = 0;
+		key = Hash(state);
+	}
+	return pruned ? key ^ PRUNED_KEY : key;
+}
+
+int TranspositionTable::MoveToKey(int square, int symmetry) {
+	return square == NO_MOVE ? NO_MOVE : Bitboard::TransformSquare(square, symmetry);
+}
+
+int TranspositionTable::MoveFromKey(int square, int symmetry) {
+	return square == NO_MOVE ? NO_MOVE : Bitboard::TransformSquare(square, Bitboard::InverseSymmetry(symmetry));
+}
+
+TranspositionTable::TranspositionTable() {
+	memory = NULL;
+	buckets = NULL;
+	bucketCount = 0;
+	age = 0;
+	Resize(DEFAULT_MEGABYTES);
+}
+
+TranspositionTable::~TranspositionTable() {
+	free(memory);
+}
+
+void TranspositionTable::Resize(size_t megabytes) {
+	free(memory);
+
+	// Use the largest power of two number of buckets that fits so that indexing is a mask
+	size_t maxBuckets = megabytes * 1024 * 1024 / sizeof(Bucket);
+	bucketCount = 1;
+	while (bucketCount * 2 <= maxBuckets) {
+		bucketCount *= 2;
+	}
+
+	// calloc leaves untouched pages unallocated until the search gets to them;
+	// the extra line of memory lets the buckets start on a cache line boundary
+	memory = (char *) calloc(bucketCount * sizeof(Bucket) + 64, 1);
+	if (!memory) {
+		std::cout << "Unable to allocate transposition table" << std::endl;
+		exit(1);
+	}
+	buckets = (Bucket *) (((uintptr_t) memory + 63) & ~(uintptr_t) 63);
+}
+
+void TranspositionTable::Clear() {
+	// The slots are atomics, so they're zeroed one by one rather than written over with memset
+	for (size_t i = 0; i < bucketCount; ++i) {
+		for (int j = 0; j < ENTRIES_PER_BUCKET; ++j) {
+			buckets[i].slots[j].check.store(0, std::memory_order_relaxed);
+			buckets[i].slots[j].data.store(0, std::memory_order_relaxed);
+		}
+	}
+	age = 0;
+}
+
+void TranspositionTable::NewSearch() {
+	++age;
+}
+
+uint64_t TranspositionTable::pack(const Entry & entry) {
+	uint32_t scoreBits;
+	memcpy(&scoreBits, &entry.score, sizeof(scoreBits));
+	return (uint64_t) scoreBits
+		| (uint64_t) (uint8_t) entry.depth << 32
+		| (uint64_t) entry.bound << 40
+		| (uint64_t) entry.move << 48
+		| (uint64_t) entry.age << 56;
+}
+
+TranspositionTable::Entry TranspositionTable::unpack(uint64_t check, uint64_t data) {
+	Entry entry;
+	uint32_t scoreBits = (uint32_t) data;
+	memcpy(&entry.score, &scoreBits, sizeof(scoreBits));
+	entry.key = check ^ data;
+	entry.depth = (int8_t) (data >> 32);
+	entry.bound = (uint8_t) (data >> 40);
+	entry.move = (uint8_t) (data >> 48);
+	entry.age = (uint8_t) (data >> 56);
+	return entry;
+}
+
+bool TranspositionTable::Probe(uint64_t key, Entry * entry) {
+	Bucket & bucket = buckets[key & (bucketCount - 1)];
+	for (int i = 0; i < ENTRIES_PER_BUCKET; ++i) {
+		uint64_t data = bucket.slots[i].data.load(std::memory_order_relaxed);
+		uint64_t check = bucket.slots[i].check.load(std::memory_order_relaxed);
+		if ((check ^ data) == key && data) {
+			*entry = unpack(check, data);
+			return entry->bound != NONE;
+		}
+	}
+	return false;
+}
+
+void TranspositionTable::Store(uint64_t key, int depth, Bound bound, double score, int move) {
+	uint8_t currentAge = age.load(std::memory_order_relaxed);
+	Bucket & bucket = buckets[key & (bucketCount - 1)];
+
+	// Replacement policy: overwrite the same position if it is already here, unless that holds a deeper search
+	// from this generation and the new result isn't exact (ProbCut's shallow searches and aspiration re-searches
+	// of a node would otherwise throw its deeper result away); otherwise take an empty slot,
+	// or else the slot whose entry is worth the least (shallow entries from old searches go first)
+	Slot * replace = &bucket.slots[0];
+	Entry old = unpack(replace->check.load(std::memory_order_relaxed), replace->data.load(std::memory_order_relaxed));
+	int worstValue = INT32_MAX;
+	for (int i = 0; i < ENTRIES_PER_BUCKET; ++i) {
+		Slot & slot = bucket.slots[i];
+		Entry e = unpack(slot.check.load(std::memory_order_relaxed), slot.data.load(std::memory_order_relaxed));
+		if (e.key == key || e.bound == NONE) {
+			replace = &slot;
+			old = e;
+			break;
+		}
+		int value = e.depth - 8 * (uint8_t) (currentAge - e.age);
+		if (value < worstValue) {
+			worstValue = value;
+			replace = &slot;
+			old = e;
+		}
+	}
+
+	// Keep a previously found best move if this search didn't produce one
+	if (move == NO_MOVE && old.key == key) {
+		move = old.move;
+	}
+
+	// A deeper entry that stays still takes the best move, if it has none of its own
+	if (old.key == key && old.bound != NONE && old.depth > depth && old.age == currentAge && bound != EXACT) {
+		if (old.move == NO_MOVE && move != NO_MOVE) {
+			old.move = (uint8_t) move;
+			uint64_t data = pack(old);
+			replace->check.store(key ^ data, std::memory_order_relaxed);
+			replace->data.store(data, std::memory_order_relaxed);
+		}
+		return;
+	}
+
+	Entry entry;
+	entry.key = key;
+	entry.score = (float) score;
+	entry.depth = (int8_t) depth;
+	entry.bound = (uint8_t) bound;
+	entry.move = (uint8_t) move;
+	entry.age = currentAge;
+
+	uint64_t data = pack(entry);
+	replace->check.store(key ^ data, std::memory_order_relaxed);
+	replace->data.store(data, std::memory_order_relaxed);
+}
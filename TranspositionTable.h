@@ -0,0 +1,118 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include "Utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+class TranspositionTable {
+
+public:
+
+	// What the stored score says about the true value of the position
+	enum Bound { NONE = 0, EXACT = 1, LOWER = 2, UPPER = 3 };
+
+	// Marks an entry that has no best move (e.g. all moves failed low)
+	static const int NO_MOVE = 64;
+
+	// Scores are stored from the point of view of the player to move in the position,
+	// so an entry is valid no matter which side was at the root when it was written.
+	// This is the unpacked form handed out by Probe
+	struct Entry {
+		uint64_t key;
+		float score;
+		int8_t depth; // Remaining depth the score was searched to
+		uint8_t bound;
+		uint8_t move; // Square of the best move, or NO_MOVE
+		uint8_t age; // Search generation the entry was written in
+	};
+
+	// An entry as it sits in the table. The table is shared by every search thread without locks,
+	// so the key is stored XORed with the packed data: if two threads write the same slot at once
+	// and the halves get mixed up, the key check fails instead of handing back another position's data
+	struct Slot {
+		std::atomic<uint64_t> check;
+		std::atomic<uint64_t> data;
+	};
+
+	static const int ENTRIES_PER_BUCKET = 4;
+
+	// One bucket fills exactly one cache line, so a probe costs a single memory access
+	struct Bucket {
+		Slot slots[ENTRIES_PER_BUCKET];
+	};
+
+	static const size_t DEFAULT_MEGABYTES = 64;
+
+	TranspositionTable();
+	~TranspositionTable();
+
+	// Reallocates the table to fit in the given memory budget (rounded down to a power of two buckets);
+	// all stored entries are lost
+	void Resize(size_t megabytes);
+
+	// Removes every stored entry; must not be called while a search is running
+	void Clear();
+
+	// Should be called once before each search so that entries from older searches get replaced first
+	void NewSearch();
+
+	// Copies the entry for the given key into the provided entry and returns true if there is one
+	bool Probe(uint64_t, Entry *);
+
+	// Stores a search result for the given key
+	void Store(uint64_t, int, Bound, double, int);
+
+	// Returns the size of the table in bytes
+	size_t Size() { return bucketCount * sizeof(Bucket); }
+
+	// Zobrist hash of a state; built a byte at a time so it only takes 16 table lookups
+	static uint64_t Hash(GameState);
+
+	// Hash of the state's canonical form (see GameState::Canonical), which every rotation and reflection of
+	// it shares, and the symmetry that takes the state there
+	static uint64_t CanonicalHash(GameState, int * symmetry);
+
+	// Positions with at least this many empty squares are keyed canonically in the table: near the start of the
+	// game the same position is often reached rotated or reflected, and canonicalizing costs next to nothing
+	// beside the few nodes there are this high up. Deeper in the game the extra hits aren't worth the work
+	static const int CANONICAL_EMPTIES = 50;
+
+	static const uint64_t PRUNED_KEY = 0x9b05688c2b3e6c1fULL;
+
+	// The table key of a state, and the symmetry its stored moves are turned by (0 when it isn't keyed canonically).
+	// Searches pruned with Multi-ProbCut key their entries apart, so that an engine searching full width never
+	// takes a pruned score as exact, and the other way round, when both share the table (as in a tournament)
+	static uint64_t Key(GameState, bool pruned, int * symmetry);
+
+	// Turn a square onto the board the key was taken from and back again; NO_MOVE is left as it is
+	static int MoveToKey(int square, int symmetry);
+	static int MoveFromKey(int square, int symmetry);
+
+private:
+
+	// Raw allocation, and the cache line aligned bucket array inside of it
+	char * memory;
+	Bucket * buckets;
+	size_t bucketCount;
+
+	// Bumped by every search; several games can be searching at once
+	std::atomic<uint8_t> age;
+
+	static uint64_t zobrist[16][256];
+	static bool zobristInitialized;
+
+	static void initZobrist();
+
+	static uint64_t pack(const Entry &);
+	static Entry unpack(uint64_t, uint64_t);
+
+	// Copying would share the underlying memory
+	TranspositionTable(const TranspositionTable &);
+	TranspositionTable & operator=(const TranspositionTable &);
+
+};
+
+#endif
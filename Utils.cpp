@@ -1,65 +1,105 @@
 #include "Utils.h"
+#include "Bitboard.h"
 
 GameState::GameState() {
-	for (int i = 0; i < 8; ++i) {
-		// Set to starting position
-		for (int j = 0; j < 8; ++j) {
-			board[i][j] = 0;
-		}
-	}
+	own = 0;
+	opp = 0;
+}
+
+GameState::GameState(uint64_t o, uint64_t p) {
+	own = o;
+	opp = p;
+}
+
+GameState GameState::Start() {
+	// The first player starts on (3, 4) and (4, 3)
+	return GameState(Bitboard::SquareBit(3, 4) | Bitboard::SquareBit(4, 3), Bitboard::SquareBit(3, 3) | Bitboard::SquareBit(4, 4));
 }
 
-GameState::GameState(int id1, int id2) {
+GameState::GameState(int b[8][8], int ownId, int oppId) {
+	own = 0;
+	opp = 0;
 	for (int i = 0; i < 8; ++i) {
-		// Set to starting position
 		for (int j = 0; j < 8; ++j) {
-			if ((i == 3 && j == 3) || (i == 4 && j == 4)) {
-				board[i][j] = id2;
-			} else if ((i == 3 && j == 4) || (i == 4 && j == 3)) {
-				board[i][j] = id1;
-			} else {
-				board[i][j] = 0;
+			if (b[i][j] == ownId) {
+				own |= Bitboard::SquareBit(i, j);
+			} else if (b[i][j] == oppId) {
+				opp |= Bitboard::SquareBit(i, j);
 			}
 		}
 	}
 }
 
-GameState::GameState(int b[8][8]) {
-	for (int i = 0; i < 8; ++i) {
-		for (int j = 0; j < 8; ++j) {
-			board[i][j] = b[i][j];
+GameState GameState::ApplyMove(GameState state, uint64_t changed) {
+	return GameState(state.opp & ~changed, state.own | changed);
+}
+
+GameState GameState::Pass(GameState state) {
+	return GameState(state.opp, state.own);
+}
+
+int GameState::At(int row, int column) const {
+	uint64_t bit = Bitboard::SquareBit(row, column);
+	if (own & bit) {
+		return 1;
+	} else if (opp & bit) {
+		return 2;
+	}
+	return 0;
+}
+
+GameState GameState::Canonical(GameState state, int * symmetry) {
+	GameState best = state;
+	*symmetry = 0;
+	for (int mirror = 0; mirror < 4; ++mirror) {
+		// Each mirrored board is transposed as well, rather than transforming from scratch for every symmetry
+		GameState mirrored(Bitboard::Transform(state.own, mirror), Bitboard::Transform(state.opp, mirror));
+		GameState transposed(Bitboard::Transform(mirrored.own, 4), Bitboard::Transform(mirrored.opp, 4));
+		if (mirrored.own < best.own || (mirrored.own == best.own && mirrored.opp < best.opp)) {
+			best = mirrored;
+			*symmetry = mirror;
+		}
+		if (transposed.own < best.own || (transposed.own == best.own && transposed.opp < best.opp)) {
+			best = transposed;
+			*symmetry = mirror | 4;
 		}
 	}
+	return best;
 }
 
-GameState GameState::ApplyMove(GameState originalState, std::vector<Location> pieces, int id) {
-	GameState state = GameState(originalState.board);
-	for (unsigned int i = 0; i < pieces.size(); ++i) {
-		state.board[pieces[i].row][pieces[i].column] = id;
+MoveList::MoveList(GameState state) {
+	count = 0;
+	for (uint64_t moves = Bitboard::Moves(state.own, state.opp); moves; moves &= moves - 1) {
+		int square = Bitboard::FirstSquare(moves);
+		squares[count] = square;
+		changed[count] = (1ULL << square) | Bitboard::Flips(state.own, state.opp, square);
+		++count;
 	}
-	return state;
 }
 
-Location::Location() : Location(0, 0) { }
+Location::Location() {
+	square = 0;
+}
 
-Location::Location(int r, int c) {
-	row = r;
-	column = c;
-	extras = "";
+Location::Location(int row, int column) {
+	square = row * 8 + column;
 }
 
-Location::Location(int r, int c, std::string e) {
-	row = r;
-	column = c;
-	extras = e;
+Location Location::FromSquare(int square) {
+	Location l;
+	l.square = square;
+	return l;
 }
 
-bool Location::operator==(const Location &l) {
-	return (l.column == this->column && l.row == this->row);
+std::string Location::Name() const {
+	std::string name;
+	name += (char) ('a' + GetColumn());
+	name += (char) ('1' + GetRow());
+	return name;
 }
 
 std::ostream& operator<<(std::ostream& os, const Location& l) {
-	os << "(" << l.row << ", " << l.column << ")";
+	os << "(" << l.GetRow() << ", " << l.GetColumn() << ")";
 	return os;
 }
 
@@ -71,6 +111,6 @@ MoveVal::MoveVal(double v, Location m) {
 }
 
 std::ostream& operator<<(std::ostream& os, const MoveVal& m) {
-	os << "(" << m.move.row << ", " << m.move.column << "): " << m.value;
+	os << m.move << ": " << m.value;
 	return os;
 }
\ No newline at end of file
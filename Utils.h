@@ -1,25 +1,31 @@
 #ifndef GAMESTATE_H
 #define GAMESTATE_H
 
+#include <string>
 #include <vector>
 #include <iostream>
+#include <cstdint>
 
+// A square on the board, kept as its index row * 8 + column (the bit it has in a bitboard)
+// so that moves are a single byte to copy around the search
 class Location {
 
 public:
 
-	int row;
-	int column;
-
-	// This is used to store any extra data that may be useful
-	// Really helpful when dealing with legal moves so we don't have to recompute adjacency direcions
-	std::string extras;
+	uint8_t square;
 
 	Location();
 	Location(int, int);
-	Location(int, int, std::string);
 
-	bool operator==(const Location &l);
+	static Location FromSquare(int);
+
+	int GetRow() const { return square >> 3; }
+	int GetColumn() const { return square & 7; }
+
+	// The square written the way game records write it, column letter then row number (f5)
+	std::string Name() const;
+
+	bool operator==(const Location &l) const { return square == l.square; }
 
 	friend std::ostream& operator<<(std::ostream&, const Location&);
 
@@ -29,19 +35,59 @@ class GameState {
 
 public:
 
-	int board[8][8];
+	// Bitboards of the discs belonging to the player to move and to their opponent;
+	// bit (row * 8 + column) is set if that square is occupied
+	uint64_t own;
+	uint64_t opp;
 
 	// Initialize empty board
 	GameState();
-	
-	// Initialize starting board with provided player ids
-	GameState(int, int);
 
-	GameState(int[8][8]);
+	GameState(uint64_t, uint64_t);
+
+	// Initialize starting board from the point of view of the first player to move
+	static GameState Start();
+
+	// Initialize from a board of player ids, from the point of view of the first id
+	GameState(int[8][8], int, int);
+
+	// Places the changed pieces (the move and its flips) for the player to move,
+	// then hands the turn to the opponent, so the result is seen from their side
+	static GameState ApplyMove(GameState, uint64_t);
+
+	// Hands the turn to the opponent without changing the board
+	static GameState Pass(GameState);
+
+	// Same as ApplyMove, but in place; Unmake takes the same changed pieces and the move's square to undo it
+	void Make(uint64_t changed) { uint64_t o = own; own = opp & ~changed; opp = o | changed; }
+	void Unmake(uint64_t changed, int square) { uint64_t o = own; own = opp & ~changed; opp = o | (changed & ~(1ULL << square)); }
+
+	// Returns 1 for the player to move, 2 for the opponent and 0 for an empty square
+	int At(int, int) const;
+
+	// The board is the same game under any of its 8 rotations and reflections. This picks the one with the
+	// smallest bitboards as the representative of them all, and which symmetry (see Bitboard::Transform)
+	// turns the state into it; Bitboard::TransformSquare maps moves onto it, and the inverse symmetry back
+	static GameState Canonical(GameState, int * symmetry);
+
+	bool operator==(const GameState &s) const { return own == s.own && opp == s.opp; }
+
+};
+
+// The legal moves of a state along with the pieces each one changes (see GameState::Make),
+// generated into fixed-size arrays so that searching a node never needs the heap
+class MoveList {
+
+public:
+
+	// There can't be more moves than empty squares
+	static const int MAX_MOVES = 64;
+
+	int count;
+	uint8_t squares[MAX_MOVES];
+	uint64_t changed[MAX_MOVES];
 
-	// Changes locations in given state that are provided in vector
-	// to provided id; this generally corresponds to a move
-	static GameState ApplyMove(GameState, std::vector<Location>, int);
+	explicit MoveList(GameState);
 
 };
 
@@ -13,14 +13,166 @@
  */
 
 #include <iostream>
+#include <algorithm>
 #include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <thread>
 
 #include "Game.h"
 #include "Player.h"
+#include "Endgame.h"
+#include "Pattern.h"
+#include "TimeManager.h"
+#include "SearchStats.h"
+#include "Analysis.h"
+#include "ProbCut.h"
+#include "Protocol.h"
 
 using namespace std;
 
-int main() {
+int main(int argc, char * argv[]) {
+
+	/*
+	 * Command line options
+	 */
+	const char * analyzeFile = NULL;
+	bool protocol = false;
+	bool host = false;
+	int workers = max(1u, thread::hardware_concurrency());
+	int depthLimit = 0;
+	long long nodeLimit = 0;
+	const char * cacheFile = NULL;
+	size_t cacheMegabytes = PositionCache::DEFAULT_MEGABYTES;
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+			// Transposition table memory budget in megabytes
+			Game::transpositionTable.Resize(atoi(argv[++i]));
+		} else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			// Number of search threads per computer player
+			ComputerPlayer::threads = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--parallel") && i + 1 < argc) {
+			// How the threads divide the work: shared hash table (lazy) or split points (ybw)
+			++i;
+			if (!strcmp(argv[i], "lazy")) {
+				ComputerPlayer::parallelMode = ComputerPlayer::LAZY_SMP;
+			} else if (!strcmp(argv[i], "ybw")) {
+				ComputerPlayer::parallelMode = ComputerPlayer::YOUNG_BROTHERS_WAIT;
+			} else {
+				cout << "Parallel mode must be lazy or ybw" << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--exact") && i + 1 < argc) {
+			// Solve the endgame exactly from this many empty squares
+			Endgame::exactEmpties = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--wld") && i + 1 < argc) {
+			// Solve the endgame for win/loss/draw from this many empty squares
+			Endgame::wldEmpties = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--weights") && i + 1 < argc) {
+			// Evaluate with pattern tables from this file instead of the built in heuristic
+			if (!Pattern::Load(argv[++i])) {
+				cout << "Could not load pattern weights from " << argv[i] << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--probcut") && i + 1 < argc) {
+			// Prune with Multi-ProbCut, using parameters from the calibrate tool
+			if (!ProbCut::Load(argv[++i])) {
+				cout << "Could not load ProbCut parameters from " << argv[i] << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--game-time") && i + 1 < argc) {
+			// Give each computer player this many seconds for the whole game instead of a fixed time per move
+			TimeManager::gameTime = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+			// Write a line of JSON about every computer move's search to this file (- for stdout)
+			if (!SearchStats::Open(argv[++i])) {
+				cout << "Could not open " << argv[i] << " for the search statistics" << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--ponder")) {
+			// Keep thinking while the opponent is deciding on their move
+			ComputerPlayer::ponder = true;
+		} else if (!strcmp(argv[i], "--book") && i + 1 < argc) {
+			// Opening book to play from before searching
+			if (!Game::openingBook.Open(argv[++i])) {
+				cout << "Could not open opening book " << argv[i] << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+			// Add the game to this game archive when it's over
+			if (!Game::archive.Open(argv[++i])) {
+				cout << "Could not open game archive " << argv[i] << endl;
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--cache") && i + 1 < argc) {
+			// Keep deep search and endgame results in this file, and use the ones earlier runs left there
+			cacheFile = argv[++i];
+		} else if (!strcmp(argv[i], "--cache-size") && i + 1 < argc) {
+			// Size in megabytes of the cache file, if it has to be created
+			cacheMegabytes = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--build-book") && i + 3 < argc) {
+			// Build a book from a game archive, or a file of games (one per line, like f5d6c3), using their first plies moves, then quit
+			int games = OpeningBook::Build(argv[i + 1], argv[i + 2], atoi(argv[i + 3]));
+			if (games < 0) {
+				cout << "Could not read " << argv[i + 1] << " or write " << argv[i + 2] << endl;
+				return 1;
+			}
+			cout << "Built " << argv[i + 2] << " from " << games << " games" << endl;
+			return 0;
+		} else if (!strcmp(argv[i], "--analyze") && i + 1 < argc) {
+			// Analyze every position in this file (- for stdin) and write the results to stdout, then quit (see Analysis.h)
+			analyzeFile = argv[++i];
+		} else if (!strcmp(argv[i], "--protocol")) {
+			// Take commands from stdin and answer on stdout instead of playing a game here (see Protocol.h)
+			protocol = true;
+		} else if (!strcmp(argv[i], "--host")) {
+			// The same for many games at once, searched by a pool of --threads threads (see Protocol.h)
+			host = true;
+		} else if (!strcmp(argv[i], "--workers") && i + 1 < argc) {
+			// Number of positions analyzed at once
+			workers = max(1, atoi(argv[++i]));
+		} else if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+			// Search each analyzed position to this depth
+			depthLimit = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--nodes") && i + 1 < argc) {
+			// Search each analyzed position for this many nodes
+			nodeLimit = atoll(argv[++i]);
+		} else if (!strcmp(argv[i], "--time") && i + 1 < argc) {
+			// Search each analyzed position for this many seconds, if it has no depth or node limit
+			Game::timeLimit = atoi(argv[++i]);
+		} else {
+			cout << "Usage: " << argv[0] << " [--hash megabytes] [--threads count] [--parallel lazy|ybw] [--exact empties] [--wld empties] [--weights file] [--probcut file]"
+				<< " [--game-time seconds] [--ponder] [--stats file] [--book file] [--record file] [--cache file [--cache-size megabytes]]"
+				<< " [--build-book games book plies]"
+				<< " [--analyze file [--workers count] [--depth plies] [--nodes count] [--time seconds]] [--protocol | --host]" << endl;
+			return 1;
+		}
+	}
+
+	if (cacheFile && !Game::positionCache.Open(cacheFile, cacheMegabytes)) {
+		cout << "Could not open position cache " << cacheFile << endl;
+		return 1;
+	}
+
+	if (host) {
+		return Protocol::RunHost(cin, cout, ComputerPlayer::threads);
+	}
+	if (protocol) {
+		return Protocol::Run(cin, cout);
+	}
+
+	if (analyzeFile) {
+		FILE * input = strcmp(analyzeFile, "-") ? fopen(analyzeFile, "r") : stdin;
+		if (!input) {
+			cout << "Could not open " << analyzeFile << endl;
+			return 1;
+		}
+		ios::sync_with_stdio(false);
+		long long positions = Analysis::Run(input, cout, workers, depthLimit, nodeLimit);
+		cerr << "Analyzed " << positions << " positions" << endl;
+		return 0;
+	}
 
 	/*
 	 * Get initial data